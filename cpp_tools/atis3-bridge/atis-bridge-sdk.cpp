@@ -102,9 +102,10 @@ public:
             return false;
         }
 
-        if ((int)round(ev::vtsscaler) != 1000000)
-            yWarning() << "ATIS USB typically has a clock period of 1 ms. You may need to compile event-driven "
-                          "with a cmake parameter VLIB_CLOCK_PERIOD_NS=1000 for correct time scaling.";
+        //timestamps are sent in microseconds
+        ev::usbClock::use();
+        if ((int)round(ev::buildClock::vtsscaler()) != 1000000)
+            yInfo() << "Event clock is 1 us: run readers of this camera with --clock_period 1000";
 
         limit = rf.check("limit", Value(-1)).asFloat64();
         if(limit < 0) limit  = DBL_MAX;
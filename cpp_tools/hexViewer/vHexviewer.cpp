@@ -160,13 +160,11 @@ public:
 
         while(!Thread::isStopping()) {
 
-            int qs = input_port.getPendingReads();
-            if(qs < 1) qs = 1;
+            const ev::packetBatch<ev::encoded> &batch = input_port.readBatch();
+            if(batch.empty()) return;
 
-            for(int i = 0; i < qs; i++)
+            for(auto q : batch)
             {
-                ev::packet<ev::encoded> * q = input_port.read();
-                if(!q) return;
                 for(auto &v : *q)
                 {
                     if((v.data & bits_to_check) == mask) {
@@ -13,7 +13,10 @@ using yarp::os::Value;
 void helpfunction() 
 {
     yInfo() << "USAGE:";
-    yInfo() << "--file <string> logfile path";
+    yInfo() << "--file <string> logfile path (text or binary log)";
+    yInfo() << "--save_binary <string> also store the log in the binary format for fast loading [optional]";
+    yInfo() << "--stream <bool> parse the text log in the background with bounded memory [false]";
+    yInfo() << "--read_ahead <double> seconds of data parsed ahead when streaming [1.0]";
     yInfo() << "--out <string> output video [~/Downloads/events.mp4]";
     yInfo() << "--timestamps <string> input timestamps filepath [optional]";
     yInfo() << "--fps <int> frames per second of output video [240]";
@@ -34,57 +37,10 @@ void helpfunction()
     yInfo() << "--alpha <double> events decay factor [0.3]";
 }
 
-int main(int argc, char* argv[])
+template <typename loaderType>
+void makeVideo(loaderType &loader, yarp::os::ResourceFinder &rf, cv::VideoWriter &dw,
+               std::ifstream &stampfile, cv::Size res, double period, bool vis)
 {
-
-    yarp::os::ResourceFinder rf;
-    rf.configure(argc, argv);
-    if(rf.check("help") || rf.check("h")) {
-        helpfunction();
-        return 0;
-    }
-
-    if(!rf.check("file")) {
-        yError() << "Please provide path to .log containing events";
-        helpfunction();
-        return -1;
-    }
-    std::string file_path = rf.find("file").asString();
-
-    int fps = rf.check("fps", Value(240)).asInt32();
-    double rate = rf.check("rate", Value(1.0)).asFloat64();
-    double period = 1.0/fps;
-    cv::Size res = {rf.check("width", Value(1280)).asInt32(), 
-                    rf.check("height", Value(720)).asInt32()};
-    bool vis = rf.check("vis") &&
-               rf.check("vis", Value(true)).asBool();
-    std::ifstream stampfile;
-    if(rf.check("timestamps")) 
-    {
-        stampfile.open(rf.find("timestamps").asString());
-        if(!stampfile.is_open()) {
-            yError() << "--timestamps provided but the file could not be opened" << rf.find("stamps").asString();
-        } else {
-            yInfo() << "Using timestamp file for frame timing";
-        }
-    }    
-
-    ev::offlineLoader<ev::AE> loader;
-    yInfo() << "Loading log file ... ";
-    if(!loader.load(file_path)) {
-        yError() << "Could not open log file";
-        return -1;
-    } else {
-        yInfo() << loader.getinfo();
-    }
-
-    std::string defaultpath = std::string(std::getenv("HOME")) + "/Downloads/events.mp4";
-    std::string out_path = rf.check("out", Value(defaultpath)).asString();
-    cv::VideoWriter dw;
-    dw.open(out_path,
-            cv::VideoWriter::fourcc('a','v','c','1'),
-            fps*rate, res, true);
-
     double virtual_timer = period;
     if(stampfile.is_open()) {
         stampfile >> virtual_timer;
@@ -137,14 +93,13 @@ int main(int argc, char* argv[])
             std::cout.flush();
         }
     } else if(rf.check("eros")) {
-        ev::EROS eros;
+        ev::fastEROS<> eros;
         eros.init(res.width, res.height, rf.check("block_size", Value(7)).asInt32(), rf.check("alpha", Value(0.3)).asFloat64());
 
         while(loader.incrementReadTill(virtual_timer) && !stampfile.eof()) {
             cv::Mat img, img8U;
 
-            for(auto &v : loader)
-                eros.update(v.x, v.y);
+            eros.update(loader.begin(), loader.end());
 
             eros.getSurface().copyTo(img8U);
             img8U = 255 - img8U;
@@ -174,7 +129,7 @@ int main(int argc, char* argv[])
             base.setTo(ev::white);
             int count = 0;
             for(auto &v : loader) count++;
-            iso_drawer.time_draw<ev::offlineLoader<ev::AE>::iterator>(base, loader.begin(), loader.end(), count);
+            iso_drawer.time_draw<typename loaderType::iterator>(base, loader.begin(), loader.end(), count);
 
             cv::resize(base, img, res);
             if(vis) {
@@ -190,6 +145,87 @@ int main(int argc, char* argv[])
         }
         
     }
+}
+
+int main(int argc, char* argv[])
+{
+
+    yarp::os::ResourceFinder rf;
+    rf.configure(argc, argv);
+    if(rf.check("help") || rf.check("h")) {
+        helpfunction();
+        return 0;
+    }
+
+    if(!rf.check("file")) {
+        yError() << "Please provide path to .log containing events";
+        helpfunction();
+        return -1;
+    }
+    std::string file_path = rf.find("file").asString();
+
+    int fps = rf.check("fps", Value(240)).asInt32();
+    double rate = rf.check("rate", Value(1.0)).asFloat64();
+    double period = 1.0/fps;
+    cv::Size res = {rf.check("width", Value(1280)).asInt32(), 
+                    rf.check("height", Value(720)).asInt32()};
+    bool vis = rf.check("vis") &&
+               rf.check("vis", Value(true)).asBool();
+    std::ifstream stampfile;
+    if(rf.check("timestamps")) 
+    {
+        stampfile.open(rf.find("timestamps").asString());
+        if(!stampfile.is_open()) {
+            yError() << "--timestamps provided but the file could not be opened" << rf.find("stamps").asString();
+        } else {
+            yInfo() << "Using timestamp file for frame timing";
+        }
+    }    
+
+    std::string defaultpath = std::string(std::getenv("HOME")) + "/Downloads/events.mp4";
+    std::string out_path = rf.check("out", Value(defaultpath)).asString();
+    cv::VideoWriter dw;
+
+    if(rf.check("stream") && rf.check("stream", Value(true)).asBool())
+    {
+        ev::offlineStreamer<ev::AE> loader;
+        yInfo() << "Streaming log file ... ";
+        if(!loader.load(file_path, DBL_MAX, rf.check("read_ahead", Value(1.0)).asFloat64())) {
+            yError() << "Could not open log file";
+            return -1;
+        } else {
+            yInfo() << loader.getinfo();
+        }
+
+        dw.open(out_path,
+                cv::VideoWriter::fourcc('a','v','c','1'),
+                fps*rate, res, true);
+        makeVideo(loader, rf, dw, stampfile, res, period, vis);
+    }
+    else
+    {
+        ev::offlineLoader<ev::AE> loader;
+        yInfo() << "Loading log file ... ";
+        if(!loader.load(file_path)) {
+            yError() << "Could not open log file";
+            return -1;
+        } else {
+            yInfo() << loader.getinfo();
+        }
+
+        if(rf.check("save_binary")) {
+            std::string bin_path = rf.find("save_binary").asString();
+            if(loader.save(bin_path))
+                yInfo() << "Binary log saved to" << bin_path;
+            else
+                yError() << "Could not save binary log to" << bin_path;
+        }
+
+        dw.open(out_path,
+                cv::VideoWriter::fourcc('a','v','c','1'),
+                fps*rate, res, true);
+        makeVideo(loader, rf, dw, stampfile, res, period, vis);
+    }
     std::cout << std::endl;
 
     dw.release();
@@ -85,15 +85,20 @@ bool drawerInterface::threadInit()
 bool drawerInterfaceAE::initialise(const std::string &name, int height, int width, double window_size, bool yarp_publish, const std::string &remote) 
 {
     this->name = name;
+    this->yarp_publish = yarp_publish;
+    this->img_size = {width, height};
+    if(window_size > 0.0)
+        this->window_size = window_size;
+
+    //the source is a log file, no port is needed
+    if(replay_speed >= 0.0)
+        return input.openReplay(remote, replay_speed);
+
     std::stringstream ss;
     ss << "/vFramer/" << (int)(yarp::os::Time::now())<< "/AE:i";
     yarp::os::Time::delay(1);
     this->portName = ss.str();
     this->sourceName = remote;
-    this->yarp_publish = yarp_publish;
-    this->img_size = {width, height};
-    if(window_size > 0.0)
-        this->window_size = window_size;
     bool success = input.open(portName);
     connectToRemote();
     return success;
@@ -188,7 +193,7 @@ bool rtFlowDrawer::initialise(const std::string &name, int height, int width, do
 {
     // BLOCK, n, d, update#, max_dt, tolerance, SMOOTH
     zrt_flow.initialise({width, height}, block_size, max_n, con_d, con_upd, trip_tol, smooth);
-    sample = cv::Mat(height, width, CV_8UC3);
+    sample.init({width, height}, CV_8UC3);
     vt = std::thread([this]{updateFlowBuffer();});
     return drawerInterfaceAE::initialise(name, height, width, window_size, yarp_publish, remote);
 }
@@ -200,7 +205,7 @@ void rtFlowDrawer::updateFlowBuffer()
         double tic = yarp::os::Time::now();
         zrt_flow.update();
         rate = ((yarp::os::Time::now() - tic) + rate)*0.5;
-        zrt_flow.makebgr().copyTo(sample);
+        sample.publish(zrt_flow.makebgr());
     }
 
 }
@@ -213,10 +218,11 @@ double rtFlowDrawer::updateImage()
     else
         canvas = white;
 
+    const cv::Mat &flow = sample.snapshot();
     ev::info inf = input.readAll(true);
     for (auto v = input.begin(); v != input.end(); v++) {
         zrt_flow.add(v->x, v->y, v.timestamp());
-        canvas.at<cv::Vec3b>(v->y, v->x) = sample.at<cv::Vec3b>(v->y, v->x);
+        canvas.at<cv::Vec3b>(v->y, v->x) = flow.at<cv::Vec3b>(v->y, v->x);
     }
 
     return inf.timestamp;
@@ -243,8 +249,7 @@ double erosDrawer::updateImage()
 
     ev::info inf = input.readAll(false);
 
-    for (auto &v : input)
-        EROS_vis.update(v.x, v.y);
+    EROS_vis.update(input.begin(), input.end());
 
     static cv::Mat inter;
     cv::medianBlur(EROS_vis.getSurface(), inter, 3);
@@ -259,6 +264,7 @@ double erosDrawer::updateImage()
 bool scarfDrawer::initialise(const std::string &name, int height, int width, double window_size, bool yarp_publish, const std::string &remote)
 {
     scarf.initialise({width, height}, block, alpha, C);
+    scarf_buffer.init({width, height}, CV_32F);
     vt = std::thread([this]{updateScarfRep();});
     return drawerInterfaceAE::initialise(name, height, width, window_size, yarp_publish, remote);
 }
@@ -272,6 +278,9 @@ void scarfDrawer::updateScarfRep()
         double tic = yarp::os::Time::now();
         for (auto &v : input) scarf.update(v.x, v.y, v.p);
         meas_t += yarp::os::Time::now() - tic;
+        //copied at most once per displayed frame
+        if(scarf_buffer.taken())
+            scarf_buffer.publish(scarf.getSurface());
         meas_c += inf.count;
         scarf_time = inf.timestamp;
     }
@@ -284,7 +293,7 @@ double scarfDrawer::updateImage()
 
     static cv::Mat inter;
     static std::stringstream ss;
-    scarf.getSurface().convertTo(inter, CV_8U, 255);
+    scarf_buffer.snapshot().convertTo(inter, CV_8U, 255);
     inter = 255 - inter;
     cv::cvtColor(inter, canvas, cv::COLOR_GRAY2BGR);
 
@@ -48,6 +48,7 @@ protected:
     bool yarp_publish;
     yarp::os::BufferedPort< yarp::sig::FlexImage > image_port;
     double window_size;
+    double replay_speed{-1.0};
 
     void run() override;
     bool threadInit() override;
@@ -57,6 +58,9 @@ public:
 
     drawerInterface() : PeriodicThread(0.05){};
     std::string drawerName();
+    //read the source as a log file at speed (0 = deterministic, as fast as
+    //possible). Call before initialise
+    void setReplay(double speed) { replay_speed = speed; }
     virtual bool initialise(const std::string &name, int height, int width, double window_size, 
                         bool yarp_publish = false, const std::string &remote = "") = 0;
     virtual void connectToRemote() {};
@@ -101,7 +105,7 @@ protected:
 
     ev::zrtFlow zrt_flow;
     double updateImage() override;
-    cv::Mat sample;
+    ev::surfaceBuffer sample;
 
 public:
     rtFlowDrawer(int blk_sz, int N, int D, int con_upd, double tol, int smooth): block_size(blk_sz), max_n(N), con_d(D), con_upd(con_upd), trip_tol(tol), smooth(smooth), drawerInterfaceAE(){};
@@ -123,7 +127,7 @@ class erosDrawer : public drawerInterfaceAE {
 protected:
     int kernelSize {5};
     double decay {0.3};
-    ev::EROS EROS_vis;
+    ev::tiledSurface< ev::fastEROS<> > EROS_vis;
     double updateImage() override;
     
 public:
@@ -134,6 +138,7 @@ public:
 class scarfDrawer : public drawerInterfaceAE {
 protected:
     ev::SCARF scarf;
+    ev::surfaceBuffer scarf_buffer;
     std::thread vt;
     int meas_c{0};
     double meas_t{0.0};
@@ -44,6 +44,7 @@ public:
             yInfo() << "vFramer - visualisation of event data";
             yInfo() << "--<iso, grey, black, eros, corner, flow, scarf> : drawer style";
             yInfo() << "--src[1-9] : connect to up to 10 remotes";
+            yInfo() << "--replay <double> : sources are log files replayed at this speed (0 = as fast as possible, repeatable)";
             yInfo() << "======================";
             yInfo() << "--name : global module name for ports";
             yInfo() << "--height, --width : set resolution";
@@ -68,11 +69,6 @@ public:
             return false;
         }
 
-        if (!yarp::os::Network::checkNetwork(2.0)) {
-            yError() << "Could not find yarp network";
-            return false;
-        }
-
         //admin options
         std::string moduleName = rf.check("name", Value("/vFramer")).asString();
         setName(moduleName.c_str());
@@ -87,6 +83,14 @@ public:
 
         bool yarp_publish = rf.check("yarp_publish") && rf.check("yarp_publish", Value(true)).asBool();
 
+        double replay = rf.check("replay") ? rf.check("replay", Value(0.0)).asFloat64() : -1.0;
+
+        //logs are replayed without a yarp network unless images are published
+        if ((replay < 0.0 || yarp_publish) && !yarp::os::Network::checkNetwork(2.0)) {
+            yError() << "Could not find yarp network";
+            return false;
+        }
+
         bool flip =
             rf.check("flip") && rf.check("flip", Value(true)).asBool();
 
@@ -124,6 +128,7 @@ public:
                                                                      rf.check("T", Value(0.5)).asFloat64(),
                                                                      rf.check("S", Value(5)).asInt32()));
 
+            publishers.back()->setReplay(replay);
             if(publishers.back()->initialise(remote, height, width, window_size, yarp_publish, remote))
             {
                 yInfo() << "Drawing" << style << "from" << remote;
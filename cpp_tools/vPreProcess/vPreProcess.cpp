@@ -47,6 +47,10 @@ private:
     bool flag_vision;
     visionFunctions vision;
 
+    //timestamps unwrapped once for all outputs
+    ev::vtsHelper unwrapper;
+    std::vector<uint64_t> stamps;
+
     bool flag_imu;
     imuFunctions imu;
 
@@ -66,6 +70,10 @@ private:
     int rate_n{0};
     bool flag_stats{false};
     std::deque<double> plot_rates;
+
+    //port telemetry
+    std::string telemetry_file;
+    bool telemetry_rpc{false};
     void visualise_rate();
 
 public:
@@ -91,6 +99,7 @@ vPreProcess::~vPreProcess()
     skin.close();
     audio.close();
     rate_port.close();
+    ev::closeTelemetryPort();
 }
 
 bool vPreProcess::configure(yarp::os::ResourceFinder &rf) 
@@ -99,6 +108,10 @@ bool vPreProcess::configure(yarp::os::ResourceFinder &rf)
         yInfo() << "--local_stamp <bool>: overwrite the packet stamp with one"
                    "immediately as the packet arrives";
         yInfo() << "--stats <bool>: visualise event-rate stats";
+        yInfo() << "--clock_period <int>: event clock period (ns) [build value]";
+        yInfo() << "--timer_bits <int>: event timestamp bits [build value]";
+        yInfo() << "--telemetry <path>: append port statistics to a csv file";
+        yInfo() << "--telemetry_rpc <bool>: reply with port statistics on <name>/telemetry:rpc";
         yInfo() << "============";
         yInfo() << "--vision <bool>: open ports for vision";
         yInfo() << "--height <int>: image size";
@@ -112,6 +125,7 @@ bool vPreProcess::configure(yarp::os::ResourceFinder &rf)
         yInfo() << "--filter_s <double>: spatial filter time window (sec)";
         yInfo() << "--filter_t <double>: temporal filter time window (sec)";
         yInfo() << "--camera_calibration_file <path>: calibration file to use for undistort";
+        yInfo() << "--unwrap <bool>: output 64 bit unwrapped timestamps (AE64)";
         yInfo() << "============";
         yInfo() << "--skin <bool>: open ports for skin";
         yInfo() << "============";
@@ -132,10 +146,15 @@ bool vPreProcess::configure(yarp::os::ResourceFinder &rf)
     setName((rf.check("name", yarp::os::Value("/vPreProcess")).asString()).c_str());
 
     // global flags
+    if(!ev::setClock(rf))
+        return false;
     use_local_stamp = rf.check("local_stamp") &&
                       rf.check("local_stamp", Value(true)).asBool();
     flag_stats = rf.check("stats") &&
                  rf.check("stats", Value(true)).asBool();
+    telemetry_file = rf.check("telemetry", Value("")).asString();
+    telemetry_rpc = rf.check("telemetry_rpc") &&
+                    rf.check("telemetry_rpc", Value(true)).asBool();
 
     //vision flags
     flag_vision = rf.check("vision") &&
@@ -154,6 +173,12 @@ bool vPreProcess::configure(yarp::os::ResourceFinder &rf)
 
     bool output_corners = rf.check("corners") &&
               rf.check("corners", Value(true)).asBool();
+    bool unwrap = rf.check("unwrap") &&
+                  rf.check("unwrap", Value(true)).asBool();
+    if(unwrap && !ev::ts_status) {
+        yWarning() << "--unwrap needs event timestamps (ENABLE_TS), ignored";
+        unwrap = false;
+    }
 
     flag_imu = rf.check("imu") &&
                rf.check("imu", Value(true)).asBool();
@@ -171,6 +196,7 @@ bool vPreProcess::configure(yarp::os::ResourceFinder &rf)
         vision.init_splits(output_stereo, output_polarities, output_corners);
         vision.init_flips(flipx, flipy, {width, height});
         vision.init_filter(t_temporal, t_spatial);
+        vision.init_unwrap(unwrap);
         if(undistort)
             vision.init_undistort(rf.find("camera_calibration_file").asString());
         if(!vision.open(getName()))
@@ -196,6 +222,9 @@ bool vPreProcess::configure(yarp::os::ResourceFinder &rf)
         return false;
     }
 
+    if(telemetry_rpc && !ev::openTelemetryPort(getName("/telemetry:rpc")))
+        return false;
+
     if(flag_stats) {
         cv::namedWindow("Event Rate", cv::WINDOW_NORMAL);
         cv::resizeWindow("Event Rate", 480, 360);
@@ -266,6 +295,9 @@ bool vPreProcess::updateModule() {
         puqs = uqs;
     }
 
+    if(!telemetry_file.empty())
+        ev::writeTelemetry(telemetry_file);
+
     return Thread::isRunning();
 
 }
@@ -275,30 +307,39 @@ void vPreProcess::run() {
     Stamp localstamp;
     while (true) {
 
-        ev::packet<encoded> *q = input.read(true);
-        if(!q) break;
+        //process all pending packets together so a backlog is cleared in
+        //bulk and sent on as a single packet per output
+        const ev::packetBatch<encoded> &batch = input.readBatch();
+        if(batch.empty()) break;
         if (use_local_stamp) localstamp.update();
-        else localstamp = q->envelope();
+        else localstamp = batch.last;
 
         double tic = Time::now();
-        for(auto &v : *q) {
-            if(IS_SKIN(v.data)) { //IS_SKIN
-                skin.process(&v);
-            } else if(IS_IMU(v.data)) {
-                imu.process((ev::IMUS *)&v);
-            } else if(IS_AUDIO(v.data)) {
-                audio.process((ev::earEvent *)&v);
-            } else { //IS_VISION
-                vision.process((ev::AE *)&v, q->envelope().getTime());
+        for(auto q : batch) {
+            if(vision.unwrapping() && q->size()) {
+                stamps.resize(q->size());
+                unwrapper.unwrap(&(*q)[0], q->size(), stamps.data());
+            }
+            for(size_t i = 0; i < q->size(); i++) {
+                encoded &v = (*q)[i];
+                if(IS_SKIN(v.data)) { //IS_SKIN
+                    skin.process(&v);
+                } else if(IS_IMU(v.data)) {
+                    imu.process((ev::IMUS *)&v);
+                } else if(IS_AUDIO(v.data)) {
+                    audio.process((ev::earEvent *)&v);
+                } else { //IS_VISION
+                    vision.process((ev::AE *)&v, q->envelope().getTime(), vision.unwrapping() ? stamps[i] : 0);
+                }
             }
         }
         rate_t += Time::now() - tic;
-        rate_n += q->size();
+        rate_n += batch.stats.count;
 
-        vision.send(localstamp, q->duration());
-        audio.send(localstamp, q->duration());
-        imu.send(localstamp, q->duration());
-        skin.send(localstamp, q->duration());
+        vision.send(localstamp, batch.stats.duration);
+        audio.send(localstamp, batch.stats.duration);
+        imu.send(localstamp, batch.stats.duration);
+        skin.send(localstamp, batch.stats.duration);
 
     }
 }
@@ -316,6 +357,7 @@ void vPreProcess::onStop()
     skin.close();
     audio.close();
     rate_port.close();
+    ev::closeTelemetryPort();
 }
 
 int main(int argc, char *argv[]) {
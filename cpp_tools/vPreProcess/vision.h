@@ -46,12 +46,67 @@ private:
     int v_total{0};
     int v_dropped{0};
     
-    //ports and packets
+    //ports and packets (64 bit timestamp ports are used if unwrapping)
     bool opened{false};
+    bool unwrap{false};
     enum port_label { LEFT, RIGHT, LNEG, RNEG, LCOR, RCOR, STEREO};
     ev::BufferedPort<ev::AE> ports[7];
     ev::packet<ev::AE> *packets[7] = 
         {nullptr,nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
+    ev::BufferedPort<ev::longAE> long_ports[7];
+    ev::packet<ev::longAE> *long_packets[7] = 
+        {nullptr,nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
+
+    template <typename E>
+    void _output(const E &datum, ev::packet<E> *(&out)[7])
+    {
+        //output to stereo combined stream
+        if (output_stereo) out[STEREO]->push_back(datum);
+
+        //output to corners stream
+        if (output_corners && datum.corner) {
+            if(datum.channel == ev::CAMERA_LEFT)
+                out[LCOR]->push_back(datum);
+            else
+                out[RCOR]->push_back(datum);
+        }
+
+        //output stereo split streams (splitting also by polarity if needed)
+        if (output_polarities && datum.p == 0) {
+            if (datum.channel == ev::CAMERA_LEFT)
+                out[LNEG]->push_back(datum);
+            else
+                out[RNEG]->push_back(datum);
+        } else {
+            if (datum.channel == ev::CAMERA_LEFT)
+                out[LEFT]->push_back(datum);
+            else
+                out[RIGHT]->push_back(datum);
+        }
+    }
+
+    template <typename E>
+    void _send(ev::BufferedPort<E> (&out_ports)[7], ev::packet<E> *(&out)[7], yarp::os::Stamp stamp, double duration)
+    {
+        for(int pl = LEFT; pl <= STEREO; pl++) {
+            if(out[pl] && out[pl]->size()) {
+                out[pl]->duration(duration);
+                out[pl]->envelope() = stamp;
+                out_ports[pl].write();
+                out[pl] = &(out_ports[pl].prepare());
+            }
+        }
+    }
+
+    template <typename E>
+    void _close(ev::BufferedPort<E> (&out_ports)[7], ev::packet<E> *(&out)[7])
+    {
+        for(int pl = LEFT; pl <= STEREO; pl++) {
+            out[pl] = nullptr;
+            out_ports[pl].unprepare();
+            out_ports[pl].close();
+        }
+    }
 
 public:
 
@@ -104,6 +159,17 @@ public:
         }
     }
 
+    void init_unwrap(bool enable)
+    {
+        unwrap = enable;
+        if(unwrap) yInfo() << "[VISION]: output unwrapped 64 bit timestamps (AE64)";
+    }
+
+    bool unwrapping()
+    {
+        return unwrap;
+    }
+
     void init_undistort(std::string calibration_file_path) 
     {
         if (calibrator.configure(calibration_file_path)) {
@@ -117,6 +183,17 @@ public:
 
     bool _openPort(const port_label label, const std::string name)
     {
+        if (unwrap) {
+            //compressed so the wider events do not increase the wire size
+            if (!long_ports[label].open(name)) {
+                yError() << "Could not open" << name;
+                return false;
+            }
+            long_ports[label].setCompression(true);
+            long_packets[label] = &(long_ports[label].prepare());
+            return true;
+        }
+
         if (!ports[label].open(name)) {
             yError() << "Could not open" << name;
             return false;
@@ -160,7 +237,7 @@ public:
         return true;
     }
 
-    void process(ev::AE *datum, double t)
+    void process(ev::AE *datum, double t, uint64_t stamp = 0)
     {
         if(!opened) return;
         //flipping
@@ -191,50 +268,28 @@ public:
             datum->y = y; datum->x = x;
         }
 
-        //output to stereo combined stream
-        if (output_stereo) packets[STEREO]->push_back(*datum);
-
-        //output to corners stream
-        if (output_corners && datum->corner) {
-            if(datum->channel == ev::CAMERA_LEFT)
-                packets[LCOR]->push_back(*datum);
-            else
-                packets[RCOR]->push_back(*datum);
-        }
-
-        //output stereo split streams (splitting also by polarity if needed)
-        if (output_polarities && datum->p == 0) {
-            if (datum->channel == ev::CAMERA_LEFT)
-                packets[LNEG]->push_back(*datum);
-            else
-                packets[RNEG]->push_back(*datum);
+        if (unwrap) {
+            ev::longAE v = {};
+            v.ts = stamp;
+            v.p = datum->p; v.x = datum->x; v.y = datum->y;
+            v.channel = datum->channel; v.type = datum->type;
+            v.skin = datum->skin; v.corner = datum->corner;
+            _output(v, long_packets);
         } else {
-            if (datum->channel == ev::CAMERA_LEFT)
-                packets[LEFT]->push_back(*datum);
-            else
-                packets[RIGHT]->push_back(*datum);
+            _output(*datum, packets);
         }
     }
 
     void send(yarp::os::Stamp stamp, double duration)
     {
-        for(int pl = LEFT; pl <= STEREO; pl++) {
-            if(packets[pl] && packets[pl]->size()) {
-                packets[pl]->duration(duration);
-                packets[pl]->envelope() = stamp;
-                ports[pl].write();
-                packets[pl] = &(ports[pl].prepare());
-            }
-        }
+        _send(ports, packets, stamp, duration);
+        _send(long_ports, long_packets, stamp, duration);
     }
 
     void close()
     {
-        for(int pl = LEFT; pl <= STEREO; pl++) {
-            packets[pl] = nullptr;
-            ports[pl].unprepare();
-            ports[pl].close();
-        }
+        _close(ports, packets);
+        _close(long_ports, long_packets);
     }
 
 };
\ No newline at end of file
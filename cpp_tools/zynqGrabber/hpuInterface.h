@@ -134,9 +134,6 @@ private:
                 }
             }
 
-            if(d2y_port.isWriting() || d2y_port_2.isWriting() || d2y_port_skin.isWriting())
-                continue;
-
             if(packet_left->size()) 
             {
                 packet_left->duration(toc - tic_left);
@@ -178,10 +175,10 @@ private:
     {
         while(params.hpu_read) {
 
-            //allocate the space in the packet within the output port
+            //allocate the space in the packet within the output port (on
+            //top of events the overload policy kept from the last write)
             ev::packet<ev::AE>& packet = d2y_port.prepare();
-            packet.clear();
-            packet.size(params.max_packet_size / sizeof(ev::encoded) + (params.max_packet_size % sizeof(ev::AE) ? 1 : 0));
+            packet.size(packet.size() + params.max_packet_size / sizeof(ev::encoded) + (params.max_packet_size % sizeof(ev::AE) ? 1 : 0));
 
             //keep filling the packet while the previous packet is still sending
             static double tic = yarp::os::Time::now();
@@ -240,6 +237,10 @@ public:
         bool spin_loopback{false};
         unsigned int max_packet_size{8*7500};
         bool split{false};
+        bool compress{false};
+        bool shared_memory{false};
+        ev::overload overload{ev::overload::coalesce};
+        unsigned int subsample{2};
         double filter{0.0};
         int roi_max_x{640};
         int roi_max_y{480};
@@ -258,6 +259,12 @@ public:
         if(params.spinnaker && params.spin_loopback) yWarning() << "Spinnaker in loopback mode";
         yInfo() << "Maximum " << params.max_packet_size / 8 << "AE in a packet";
         if(params.split) yInfo() << "Splitting stereo and skin (d2y)";
+        if(params.compress) yInfo() << "Compressing output packets (d2y)";
+        if(params.shared_memory) yInfo() << "Publishing through shared memory (d2y)";
+        if(params.overload == ev::overload::block) yInfo() << "Waiting for slow readers (d2y)";
+        if(params.overload == ev::overload::coalesce) yInfo() << "Merging packets for slow readers, up to 4 reads (d2y)";
+        if(params.overload == ev::overload::drop) yInfo() << "Dropping packets for slow readers (d2y)";
+        if(params.overload == ev::overload::subsample) yInfo() << "Subsampling by" << params.subsample << "for slow readers (d2y)";
         if(params.filter > 0.0) yInfo() << "Artificial refractory period:" << params.filter << "seconds";
 
         // open the device
@@ -305,6 +312,9 @@ public:
             return true;
         }
 
+        //a packet held back for a slow reader is dropped after a few reads
+        size_t overload_limit = 4 * (params.max_packet_size / sizeof(ev::AE) + 1);
+
         if(params.hpu_read && d2y_port.isClosed()) {
             std::string port_name = params.module + "/AE:o";
             if(params.split) port_name = params.module + "/left/AE:o";
@@ -312,6 +322,10 @@ public:
                 yError() << "Could not open" << port_name;
                 return false;
             }
+            d2y_port.setCompression(params.compress);
+            d2y_port.setOverloadPolicy(params.overload, params.subsample, overload_limit);
+            if(params.shared_memory && !d2y_port.openSharedMemory())
+                yWarning() << "Could not open shared memory for" << port_name;
         }
 
         if(params.hpu_read && params.split && d2y_port_2.isClosed()) {
@@ -320,6 +334,10 @@ public:
                 yError() << "Could not open" << port_name;
                 return false;
             }
+            d2y_port_2.setCompression(params.compress);
+            d2y_port_2.setOverloadPolicy(params.overload, params.subsample, overload_limit);
+            if(params.shared_memory && !d2y_port_2.openSharedMemory())
+                yWarning() << "Could not open shared memory for" << port_name;
         }
 
         if(params.hpu_read && params.split && d2y_port_skin.isClosed()) {
@@ -328,6 +346,10 @@ public:
                 yError() << "Could not open" << port_name;
                 return false;
             }
+            d2y_port_skin.setCompression(params.compress);
+            d2y_port_skin.setOverloadPolicy(params.overload, params.subsample, overload_limit);
+            if(params.shared_memory && !d2y_port_skin.openSharedMemory())
+                yWarning() << "Could not open shared memory for" << port_name;
         }
 
         if(params.hpu_write && y2d_port.isClosed()) {
@@ -379,6 +401,13 @@ public:
                     << dt << " seconds ("
                     << (int)(100.0 * d2y_filtered / (double)d2y_eventcount) << "% filtered)" << std::endl;
 
+            ev::writeStats ws[3] = {d2y_port.getWriteStats(), d2y_port_2.getWriteStats(), d2y_port_skin.getWriteStats()};
+            unsigned int held = ws[0].coalesced + ws[1].coalesced + ws[2].coalesced;
+            unsigned int dropped = ws[0].dropped + ws[1].dropped + ws[2].dropped;
+            if(held || dropped)
+                ss << "[SLOW ] " << held << " packets held back, "
+                   << (int)(dropped/(1000.0*dt)) << "k events/s dropped" << std::endl;
+
             d2y_eventcount = 0;
             d2y_packetcount = 0;
             d2y_filtered = 0;
@@ -60,6 +60,10 @@ class zynqGrabberModule : public yarp::os::RFModule {
             yInfo() << "--hpu_write <bool>[false]: write to hpu device";
             yInfo() << "--packet_size <int>[5120]: standard events in packet (not enforced)";
             yInfo() << "--split <bool>[false]: split data in channels";
+            yInfo() << "--compress <bool>[false]: compress output packets (needs up to date readers)";
+            yInfo() << "--shared_memory <bool>[false]: also publish to local readers on <port>/shm";
+            yInfo() << "--overload <string>[coalesce]: block, coalesce, drop or subsample packets when readers are slow";
+            yInfo() << "--subsample <int>[2]: keep 1 in N events when subsampling";
             yInfo() << "--filter <double>[0.0]: temporal filter of vision (ms) 0.0 = off";
             return false;
         }
@@ -108,6 +112,20 @@ class zynqGrabberModule : public yarp::os::RFModule {
             hpu.params.max_packet_size = 8 * rf.check("packet_size", yarp::os::Value("5120")).asInt32();
             hpu.params.split = rf.check("split") &&
                                 rf.check("split", Value(true)).asBool();
+            hpu.params.compress = rf.check("compress") &&
+                                  rf.check("compress", Value(true)).asBool();
+            hpu.params.shared_memory = rf.check("shared_memory") &&
+                                       rf.check("shared_memory", Value(true)).asBool();
+            std::string overload = rf.check("overload", Value("coalesce")).asString();
+            if(overload == "block") hpu.params.overload = ev::overload::block;
+            else if(overload == "coalesce") hpu.params.overload = ev::overload::coalesce;
+            else if(overload == "drop") hpu.params.overload = ev::overload::drop;
+            else if(overload == "subsample") hpu.params.overload = ev::overload::subsample;
+            else {
+                yError() << "--overload must be block, coalesce, drop or subsample";
+                return false;
+            }
+            hpu.params.subsample = rf.check("subsample", Value(2)).asInt32();
             hpu.params.filter = rf.check("filter", Value(0.0)).asFloat64();
 
             if(!hpu.configure())
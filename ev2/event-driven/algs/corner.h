@@ -20,8 +20,7 @@
 #include <opencv2/opencv.hpp>
 #include <deque>
 #include <thread>
-#include <mutex>
-#include <condition_variable>
+#include <chrono>
 
 #include "surface.h"
 
@@ -32,13 +31,13 @@ class corner_detector
 {
 private:
 
-    cv::Mat LUT;
     ev::SCARF scarf;
     int harris_block_size{7};
 
+    //scarf copies to the harris thread, corner scores back to detect
+    ev::surfaceBuffer scarf_buffer;
+    ev::surfaceBuffer lut_buffer;
     std::thread harris_thread;
-    std::mutex m;
-    std::condition_variable signal;
     
     double threshold{0.0};
     double score_mean{0.0};
@@ -47,16 +46,15 @@ private:
 
     void updateLUT()
     {
-        static cv::Mat blurred;
-        while(harris_block_size > 0) 
+        cv::Mat blurred, LUT;
+        //only recalculate when detect has published a new scarf
+        while(scarf_buffer.wait())
         {
-            // std::unique_lock<std::mutex> lk(m);
-            // signal.wait(lk, [this]{return eros_updated;});
-            // eros_updated = false;
-            // lk.unlock();
-            scarf.getSurface().convertTo(blurred, CV_8U, 255);
+            const cv::Mat &surface = scarf_buffer.snapshot();
+            surface.convertTo(blurred, CV_8U, 255);
             cv::GaussianBlur(blurred, blurred, cv::Size(5, 5), 0, 0);
             cv::cornerHarris(blurred, LUT, harris_block_size, 3, 0.04);
+            lut_buffer.publish(LUT);
         }
     }
 
@@ -65,8 +63,9 @@ public:
 
     void stop()
     {
-        harris_block_size = -1;
-        harris_thread.join();
+        scarf_buffer.interrupt();
+        if(harris_thread.joinable())
+            harris_thread.join();
     }
 
     void initialise(int height, int width, int harris_block_size)
@@ -75,18 +74,21 @@ public:
             harris_block_size += 1;
         this->harris_block_size = harris_block_size;
         scarf.initialise({width, height}, 10);
-        LUT = cv::Mat(height, width, CV_32F);
+        scarf_buffer.init({width, height}, CV_32F);
+        lut_buffer.init({width, height}, CV_32F);
         harris_thread = std::thread([this]{updateLUT();});
     }
 
     template <typename T>
     void detect(T begin, T end, std::deque<AE> &results)
     {
+        const cv::Mat &LUT = lut_buffer.snapshot();
+
         //first update the EROS
         for(auto &v = begin; v != end; v++) {
             scarf.update(v->x, v->y, v->p);
 
-            float& score = LUT.at<float>(v->y, v->x);
+            const float &score = LUT.at<float>(v->y, v->x);
             if(score > threshold)
                  results.push_back(*v);
 
@@ -101,11 +103,9 @@ public:
         threshold = score_mean + 2*sqrt(score_variance / count);
         //threshold = 0.00001;
 
-        // std::unique_lock<std::mutex> lk(m);
-        // eros_updated = true;
-        // lk.unlock();
-        // signal.notify_one();
-
+        //only copied once the harris thread has taken the last one
+        if(scarf_buffer.taken())
+            scarf_buffer.publish(scarf.getSurface());
 
     }
 
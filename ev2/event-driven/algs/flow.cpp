@@ -201,6 +201,12 @@ cv::Mat zrtFlow::makebgr()
 // ==================================
 const int zcflowBlock::d_coordinate = 2;
 
+//time of channel c at (x, y) of a CV_64FC2 or CV_64F surface
+static inline double _at(const cv::Mat &sae, int c, int x, int y)
+{
+    return sae.ptr<double>(y)[x * sae.channels() + c];
+}
+
 void zcflowBlock::initialise(cv::Point2i i)
 {
     index = i;
@@ -210,9 +216,9 @@ void zcflowBlock::initialise(cv::Point2i i)
     y_dist.clear();
 }
 
-bool zcflowBlock::block_update_zc(const cv::Mat &sae, int x, int y, cv::Mat &flow_mat, int block_size, cv::Point2i b_index)
+bool zcflowBlock::block_update_zc(const cv::Mat &sae, int c, int x, int y, cv::Mat &flow_mat, int block_size, cv::Point2i b_index)
 {
-    point_velocity_zc(sae, x, y, x_dist, y_dist);
+    point_velocity_zc(sae, c, x, y, x_dist, y_dist);
     if(x_dist.size() > N && x_dist.size() < 10000) {
 
         std::sort(x_dist.begin(), x_dist.end());
@@ -261,14 +267,16 @@ bool zcflowBlock::block_update_zc(const cv::Mat &sae, int x, int y, cv::Mat &flo
     return false;
 }
 
-void zcflowBlock::point_velocity_zc(const cv::Mat &sae, int x, int y, std::vector<double> &flow_x, std::vector<double> &flow_y)
+void zcflowBlock::point_velocity_zc(const cv::Mat &sae, int c, int x, int y, std::vector<double> &flow_x, std::vector<double> &flow_y)
 {
+    const double t1 = _at(sae, c, x, y);
 
     for(int j=y - d_coordinate; j <= y + d_coordinate; j++)
         for(int i= x - d_coordinate; i<= x + d_coordinate; i++)
         {   
             if(i!=x or j!=y){
-                const double dt12 = sae.at<double>(y, x) - sae.at<double>(j, i);
+                const double t2 = _at(sae, c, i, j);
+                const double dt12 = t1 - t2;
                 if(0 < dt12 && dt12 < dt)
                 {
                         //
@@ -278,7 +286,7 @@ void zcflowBlock::point_velocity_zc(const cv::Mat &sae, int x, int y, std::vecto
 
                         if(0<=n && n<=sae.rows-1 &&0<=m && m<=sae.cols-1)
                         {    
-                            const double dt23 = sae.at<double>(j, i)-sae.at<double>(n, m);
+                            const double dt23 = t2 - _at(sae, c, m, n);
                             double error = fabs(1 - dt23/dt12);
                             if(error > tolerance) continue;          //THRESHOLD
                             //valid triplet. calulate the velocity.
@@ -294,10 +302,21 @@ void zcflowBlock::point_velocity_zc(const cv::Mat &sae, int x, int y, std::vecto
 
 void zcflow::initialise(const cv::Mat_<double> &sae_p, const cv::Mat_<double> &sae_n, int block_size)
 {
-    this->sae_p = sae_p;
-    this->sae_n = sae_n;
+    update_sae(sae_p, sae_n);
+    _initialise(sae_p.size(), block_size);
+}
+
+void zcflow::initialise(channelSurface<2> &saes, int block_size)
+{
+    update_sae(saes);
+    _initialise(sae.size(), block_size);
+}
+
+void zcflow::_initialise(cv::Size res, int block_size)
+{
+    this->res = res;
     this->block_size = block_size;
-    n_blocks = sae_p.size() / block_size;
+    n_blocks = res / block_size;
     n_blocks.width+=boundary_compensation;
     n_blocks.height+=boundary_compensation;
     n_blocks.width+=camera_size_compensation;
@@ -305,9 +324,9 @@ void zcflow::initialise(const cv::Mat_<double> &sae_p, const cv::Mat_<double> &s
     flow_blocks.width = n_blocks.width;
     flow = cv::Mat::zeros(flow_blocks, CV_32FC2);
     blocks.resize(n_blocks.area());
-    flowbgr = cv::Mat::zeros(sae_p.size(), CV_8UC3);
-    flow_x = cv::Mat::zeros(sae_p.size(), CV_32F);
-    flow_y = cv::Mat::zeros(sae_p.size(), CV_32F);
+    flowbgr = cv::Mat::zeros(res, CV_8UC3);
+    flow_x = cv::Mat::zeros(res, CV_32F);
+    flow_y = cv::Mat::zeros(res, CV_32F);
 
 
 
@@ -322,6 +341,13 @@ void zcflow::update_sae(const cv::Mat_<double> &sae_p, const cv::Mat_<double> &s
 {
     this->sae_p = sae_p;
     this->sae_n = sae_n;
+    separate = true;
+}
+
+void zcflow::update_sae(channelSurface<2> &saes)
+{
+    sae = saes.getSurface();
+    separate = false;
 }
 
 void zcflow::clear_blocks()
@@ -335,23 +361,28 @@ void zcflow::clear_blocks()
 
 void zcflow::update(double tic)
 {
-
-    for(int y=zcflowBlock::d_coordinate; y< sae_p.rows-zcflowBlock::d_coordinate; y++)
-        for(int x=zcflowBlock::d_coordinate; x<sae_p.cols-zcflowBlock::d_coordinate; x++)
+    //the polarities are channels 0 and 1 of sae, or channel 0 of each of
+    //the separate surfaces
+    const cv::Mat &s0 = separate ? sae_p : sae;
+    const cv::Mat &s1 = separate ? sae_n : sae;
+    const int c1 = separate ? 0 : 1;
+
+    for(int y=zcflowBlock::d_coordinate; y< res.height-zcflowBlock::d_coordinate; y++)
+        for(int x=zcflowBlock::d_coordinate; x<res.width-zcflowBlock::d_coordinate; x++)
         {
-            if(sae_p.at<double>(y, x) > toc)
+            if(_at(s0, 0, x, y) > toc)
             {
                 b_index = blocks[int(y/block_size)*n_blocks.width+int(x/block_size)].index;
                 b_index.x += 1;
                 b_index.y += 1; 
-                blocks[int(y/block_size)*n_blocks.width+int(x/block_size)].block_update_zc(sae_p, x, y, flow, block_size, b_index);
+                blocks[int(y/block_size)*n_blocks.width+int(x/block_size)].block_update_zc(s0, 0, x, y, flow, block_size, b_index);
             }
-            if(sae_n.at<double>(y, x) > toc)
+            if(_at(s1, c1, x, y) > toc)
             {
                 b_index = blocks[int(y/block_size)*n_blocks.width+int(x/block_size)].index; 
                 b_index.x += 1;
                 b_index.y += 1; 
-                blocks[int(y/block_size)*n_blocks.width+int(x/block_size)].block_update_zc(sae_n, x, y, flow, block_size, b_index);
+                blocks[int(y/block_size)*n_blocks.width+int(x/block_size)].block_update_zc(s1, c1, x, y, flow, block_size, b_index);
             }
 
         }
@@ -386,7 +417,7 @@ cv::Mat zcflow::makebgr()
     cv::Mat small;
     cv::cvtColor(hsv, small, cv::COLOR_HSV2BGR);
     small.convertTo(small, CV_8UC3, 255);
-    cv::resize(small, flowbgr, sae_p.size(), 0.0, 0.0, cv::INTER_LINEAR);
+    cv::resize(small, flowbgr, res, 0.0, 0.0, cv::INTER_LINEAR);
     return flowbgr;
 } 
 }
\ No newline at end of file
@@ -20,6 +20,7 @@
 #include <numeric>
 #include <iostream>
 #include <yarp/os/Time.h>
+#include "surface.h"
 
 namespace ev {
 
@@ -129,9 +130,10 @@ public:
 
     void initialise(cv::Point2i i);
 
-    bool block_update_zc(const cv::Mat &sae, int x, int y, cv::Mat &flow_mat, int block_size, cv::Point2i b_index);
+    //sae holds both polarities (CV_64FC2) or one (CV_64F), c selects one
+    bool block_update_zc(const cv::Mat &sae, int c, int x, int y, cv::Mat &flow_mat, int block_size, cv::Point2i b_index);
 
-    void point_velocity_zc(const cv::Mat &sae, int x, int y, std::vector<double> &flow_x, std::vector<double> &flow_y);
+    void point_velocity_zc(const cv::Mat &sae, int c, int x, int y, std::vector<double> &flow_x, std::vector<double> &flow_y);
 
 };
 
@@ -147,8 +149,13 @@ private:
     cv::Mat flow_x;
     cv::Mat flow_y;
 
+    //both polarities interleaved (CV_64FC2), or separate sae_p and sae_n
+    //read in place
+    cv::Mat sae;
     cv::Mat sae_p;
     cv::Mat sae_n;
+    bool separate{false};
+    cv::Size res;
 
     double toc{0.0};
 
@@ -157,6 +164,7 @@ private:
     cv::Size flow_blocks;
     cv::Point2i b_index;
 
+    void _initialise(cv::Size res, int block_size);
 
 public:
     cv::Mat flowbgr;
@@ -165,8 +173,10 @@ public:
     int boundary_compensation = 2;
 
     void initialise(const cv::Mat_<double> &sae_p, const cv::Mat_<double> &sae_n, int block_size);
+    void initialise(channelSurface<2> &saes, int block_size);
     
     void update_sae(const cv::Mat_<double> &sae_p, const cv::Mat_<double> &sae_n);
+    void update_sae(channelSurface<2> &saes);
     
     void clear_blocks();
 
@@ -1,4 +1,5 @@
 #include <event-driven/algs/surface.h>
+#include <limits>
 using namespace ev;
 
 cv::Mat surface::getSurface() 
@@ -27,4 +28,156 @@ void surface::temporalDecay(double ts, double alpha) {
 void surface::spatialDecay(int k) 
 {
     cv::GaussianBlur(surf, surf, cv::Size(k, k), 0);
-}
\ No newline at end of file
+}
+
+void lazySurface::_init(int width, int height, int kernel_size)
+{
+    if (kernel_size % 2 == 0)
+        kernel_size++;
+    this->kernel_size = kernel_size;
+    this->half_kernel = kernel_size / 2;
+    this->width = width;
+    this->height = height;
+    stride = width + half_kernel * 2;
+    events = 0;
+
+    size_t n = (size_t)stride * (height + half_kernel * 2);
+    column.assign(n, 0);
+    baseline.assign(n, 0);
+    set.assign(n, 0);
+}
+
+//pixel values of n pixels of row y starting from x. The neighbourhood count
+//is a running sum of the column counts along the row
+void lazySurface::_row(int y, int x, int n, uint8_t *output) const
+{
+    const uint32_t *c = column.data() + (y + half_kernel) * stride + x;
+    size_t i = (size_t)(y + half_kernel) * stride + x + half_kernel;
+    const uint32_t last = table.size() - 1;
+
+    uint32_t b = 0;
+    for(int k = 0; k < kernel_size - 1; k++)
+        b += c[k];
+    for(int k = 0; k < n; k++, i++) {
+        b += c[k + kernel_size - 1];
+        output[k] = set[i] ? table[std::min(b - baseline[i], last)] : 0;
+        b -= c[k];
+    }
+}
+
+//keep the events since each pixel was set (saturated at the table size) and
+//restart the counts from zero
+void lazySurface::_rebase()
+{
+    const uint32_t last = table.size() - 1;
+    for(int y = 0; y < height; y++) {
+        const uint32_t *c = column.data() + (y + half_kernel) * stride;
+        size_t i = (size_t)(y + half_kernel) * stride + half_kernel;
+        uint32_t b = 0;
+        for(int k = 0; k < kernel_size - 1; k++)
+            b += c[k];
+        for(int x = 0; x < width; x++, i++) {
+            b += c[x + kernel_size - 1];
+            baseline[i] = 0u - std::min(b - baseline[i], last);
+            b -= c[x];
+        }
+    }
+    std::fill(column.begin(), column.end(), 0);
+    events = 0;
+}
+
+cv::Mat lazySurface::getSurface()
+{
+    return getSurface({0, 0, width, height});
+}
+
+cv::Mat lazySurface::getSurface(const cv::Rect &roi)
+{
+    cv::Mat output(roi.height, roi.width, CV_8U);
+    for(int y = 0; y < roi.height; y++)
+        _row(roi.y + y, roi.x, roi.width, output.ptr<uint8_t>(y));
+    return output;
+}
+
+void lazyEROS::init(int width, int height, int kernel_size, double parameter)
+{
+    _init(width, height, kernel_size);
+
+    //the value of a pixel after n decays, until it rounds to 0
+    double odecay = pow(parameter, 1.0 / this->kernel_size);
+    table.clear();
+    for(double v = 255.0; v >= 0.5 && table.size() < 65535; v *= odecay)
+        table.push_back(std::round(v));
+    table.push_back(0);
+}
+
+void lazyTOS::init(int width, int height, int kernel_size, double parameter)
+{
+    _init(width, height, kernel_size);
+
+    double threshold = 255.0 - this->kernel_size * parameter;
+    table.clear();
+    for(double v = 255.0; v > 0.0; v = v < threshold ? 0.0 : v - 1.0)
+        table.push_back(v);
+    table.push_back(0);
+}
+
+void lazyTimeSurface::init(int width, int height)
+{
+    this->width = width;
+    this->height = height;
+    stamps.assign((size_t)width * height, std::numeric_limits<double>::lowest());
+}
+
+cv::Mat lazyTimeSurface::getSurface(double ts, double alpha)
+{
+    cv::Mat output(height, width, CV_8U);
+    const double *t = stamps.data();
+    for(int y = 0; y < height; y++) {
+        uint8_t *o = output.ptr<uint8_t>(y);
+        for(int x = 0; x < width; x++, t++)
+            o[x] = *t == std::numeric_limits<double>::lowest() ? 0 :
+                   (uint8_t)(255.0 * std::exp(alpha * std::min(*t - ts, 0.0)) + 0.5);
+    }
+    return output;
+}
+
+void surfaceBuffer::init(cv::Size size, int type)
+{
+    for(auto &b : buffers)
+        b = cv::Mat(size, type, cv::Scalar(0));
+}
+
+void surfaceBuffer::publish(const cv::Mat &surface)
+{
+    surface.copyTo(buffers[back]);
+    epochs[back] = ++published;
+    back = shared.exchange(back | fresh, std::memory_order_acq_rel) & ~fresh;
+
+    //a reader between checking and sleeping holds m, so cannot miss this
+    { std::lock_guard<std::mutex> lk(m); }
+    signal.notify_one();
+}
+
+const cv::Mat& surfaceBuffer::snapshot()
+{
+    if(shared.load(std::memory_order_relaxed) & fresh)
+        front = shared.exchange(front, std::memory_order_acq_rel) & ~fresh;
+    return buffers[front];
+}
+
+bool surfaceBuffer::wait()
+{
+    std::unique_lock<std::mutex> lk(m);
+    signal.wait(lk, [this]{return interrupted || (shared.load(std::memory_order_relaxed) & fresh);});
+    return !interrupted;
+}
+
+void surfaceBuffer::interrupt()
+{
+    {
+        std::lock_guard<std::mutex> lk(m);
+        interrupted = true;
+    }
+    signal.notify_one();
+}
@@ -2,9 +2,56 @@
 
 #include <opencv2/opencv.hpp>
 #include <tuple>
+#include <cstdint>
+#include <vector>
+#include <utility>
+#include <atomic>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 namespace ev {
 
+//enables the batch updates (begin, end) only for iterators of events, so
+//update(v.x, v.y) still selects the single event update
+template <typename iterator> using eventIterator = decltype(std::declval<iterator&>()->x);
+
+template <typename iterator> auto _eventTime(iterator &i, int) -> decltype((double)i.timestamp())
+{
+    return i.timestamp();
+}
+template <typename iterator> double _eventTime(iterator &, long)
+{
+    return 0.0;
+}
+template <typename E> auto _eventPolarity(const E &v, int) -> decltype((int)v.p)
+{
+    return v.p;
+}
+template <typename E> int _eventPolarity(const E &, long)
+{
+    return 0;
+}
+
+//the time of an event in a batch: the packet timestamp for ev::
+//iterators that provide one, otherwise 0
+template <typename iterator> double eventTime(iterator &i)
+{
+    return _eventTime(i, 0);
+}
+
+//the polarity of an event, 0 for event types without one
+template <typename E> int eventPolarity(const E &v)
+{
+    return _eventPolarity(v, 0);
+}
+
 class surface 
 {
 protected:
@@ -16,6 +63,14 @@ protected:
     cv::Rect actual_region;
     cv::Mat surf;
 
+    //call f(x, y, t, p) for each event. The loop is compiled for the
+    //iterator and event type with f inlined: no virtual call per event
+    template <typename iterator, typename F> static void _each(iterator begin, iterator end, F f)
+    {
+        for(; begin != end; begin++)
+            f(begin->x, begin->y, eventTime(begin), eventPolarity(*begin));
+    }
+
 public:
    
     virtual cv::Mat getSurface();
@@ -33,6 +88,165 @@ class EROS : public surface {
         surf({x, y, kernel_size, kernel_size}) *= odecay;
         surf.at<double>(y+half_kernel, x+half_kernel) = 255.0;
     }
+
+    template <typename iterator, typename = eventIterator<iterator>>
+    void update(iterator begin, iterator end)
+    {
+        const double odecay = pow(parameter, 1.0 / kernel_size);
+        const size_t step = surf.step1();
+        double *data = surf.ptr<double>(0);
+        _each(begin, end, [&](int x, int y, double, int) {
+            double *row = data + y * step + x;
+            for(int yi = 0; yi < kernel_size; yi++, row += step)
+                for(int xi = 0; xi < kernel_size; xi++)
+                    row[xi] *= odecay;
+            data[(y + half_kernel) * step + x + half_kernel] = 255.0;
+        });
+    }
+};
+
+/// \brief EROS on a uint8_t or float surface, updated without creating a
+/// cv::Mat per event. Each kernel row is decayed with 128 bit SIMD (SSE2 or
+/// NEON, a single instruction group for kernels up to 16 (uint8_t) or 4
+/// (float) pixels wide). The uint8_t surface decays in 8 bit fixed point.
+template <typename P = uint8_t> class fastEROS
+{
+private:
+    //rows are padded so a full vector can be loaded past the last kernel
+    static const int simd_pad = 16;
+
+    int kernel_size{0};
+    int half_kernel{0};
+    size_t stride{0};
+    float decay{1.0f};
+    uint16_t decay_q8{256};
+
+    cv::Rect actual_region;
+    cv::Mat surf;
+    P *data{nullptr};
+
+#if defined(__SSE2__) || defined(__ARM_NEON)
+    //lanes of the last vector of a row that belong to the kernel
+    uint8_t mask8[16];
+    uint32_t mask32[4];
+#endif
+
+    inline void _decayRow(uint8_t *row)
+    {
+        int i = 0;
+#if defined(__SSE2__)
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i d = _mm_set1_epi16(decay_q8);
+        for(; i < kernel_size; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(row + i));
+            __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), d), 8);
+            __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), d), 8);
+            __m128i r = _mm_packus_epi16(lo, hi);
+            if(i + 16 > kernel_size) {
+                __m128i m = _mm_loadu_si128((const __m128i *)mask8);
+                r = _mm_or_si128(_mm_and_si128(m, r), _mm_andnot_si128(m, v));
+            }
+            _mm_storeu_si128((__m128i *)(row + i), r);
+        }
+#elif defined(__ARM_NEON)
+        const uint8x8_t d = vdup_n_u8((uint8_t)decay_q8);
+        for(; i < kernel_size; i += 16) {
+            uint8x16_t v = vld1q_u8(row + i);
+            uint8x16_t r = vcombine_u8(vshrn_n_u16(vmull_u8(vget_low_u8(v), d), 8),
+                                       vshrn_n_u16(vmull_u8(vget_high_u8(v), d), 8));
+            if(i + 16 > kernel_size)
+                r = vbslq_u8(vld1q_u8(mask8), r, v);
+            vst1q_u8(row + i, r);
+        }
+#else
+        for(; i < kernel_size; i++)
+            row[i] = (row[i] * decay_q8) >> 8;
+#endif
+    }
+
+    inline void _decayRow(float *row)
+    {
+        int i = 0;
+#if defined(__SSE2__)
+        const __m128 d = _mm_set1_ps(decay);
+        for(; i < kernel_size; i += 4) {
+            __m128 v = _mm_loadu_ps(row + i);
+            __m128 r = _mm_mul_ps(v, d);
+            if(i + 4 > kernel_size) {
+                __m128 m = _mm_loadu_ps((const float *)mask32);
+                r = _mm_or_ps(_mm_and_ps(m, r), _mm_andnot_ps(m, v));
+            }
+            _mm_storeu_ps(row + i, r);
+        }
+#elif defined(__ARM_NEON)
+        const float32x4_t d = vdupq_n_f32(decay);
+        for(; i < kernel_size; i += 4) {
+            float32x4_t v = vld1q_f32(row + i);
+            float32x4_t r = vmulq_f32(v, d);
+            if(i + 4 > kernel_size)
+                r = vbslq_f32(vld1q_u32(mask32), r, v);
+            vst1q_f32(row + i, r);
+        }
+#else
+        for(; i < kernel_size; i++)
+            row[i] *= decay;
+#endif
+    }
+
+public:
+
+    void init(int width, int height, int kernel_size = 5, double parameter = 0.3)
+    {
+        if (kernel_size % 2 == 0)
+            kernel_size++;
+        this->kernel_size = kernel_size;
+        this->half_kernel = kernel_size / 2;
+        decay = pow(parameter, 1.0 / kernel_size);
+        decay_q8 = (uint16_t)std::min(decay * 256.0 + 0.5, 255.0);
+
+        //rows are a multiple of 16 bytes so each row starts aligned
+        stride = width + half_kernel * 2 + simd_pad;
+        stride = (stride * sizeof(P) + 15) / 16 * 16 / sizeof(P);
+        surf = cv::Mat(height + half_kernel * 2, stride, cv::DataType<P>::type, cv::Scalar(0));
+        data = surf.ptr<P>(0);
+        actual_region = {half_kernel, half_kernel, width, height};
+
+#if defined(__SSE2__) || defined(__ARM_NEON)
+        for(int i = 0; i < 16; i++)
+            mask8[i] = i < (kernel_size - 1) % 16 + 1 ? 0xFF : 0x00;
+        for(int i = 0; i < 4; i++)
+            mask32[i] = i < (kernel_size - 1) % 4 + 1 ? 0xFFFFFFFF : 0x00;
+#endif
+    }
+
+    inline void update(int x, int y)
+    {
+        P *row = data + y * stride + x;
+        for(int i = 0; i < kernel_size; i++, row += stride)
+            _decayRow(row);
+        data[(y + half_kernel) * stride + x + half_kernel] = 255;
+    }
+
+    //update with all events between begin and end
+    template <typename iterator, typename = eventIterator<iterator>>
+    void update(iterator begin, iterator end)
+    {
+        for(; begin != end; begin++)
+            update(begin->x, begin->y);
+    }
+
+    //update with n events stored as arrays (e.g. ev::eventArrays)
+    void update(const uint16_t *x, const uint16_t *y, size_t n)
+    {
+        for(size_t i = 0; i < n; i++)
+            update(x[i], y[i]);
+    }
+
+    cv::Mat getSurface()
+    {
+        cv::Mat output; surf(actual_region).convertTo(output, CV_8U);
+        return output;
+    }
 };
 
 class TOS : public surface 
@@ -56,6 +270,21 @@ class TOS : public surface
         }
         surf.at<double>(y+half_kernel, x+half_kernel) = 255.0;
     }
+
+    template <typename iterator, typename = eventIterator<iterator>>
+    void update(iterator begin, iterator end)
+    {
+        const double threshold = 255.0 - kernel_size * parameter;
+        const size_t step = surf.step1();
+        double *data = surf.ptr<double>(0);
+        _each(begin, end, [&](int x, int y, double, int) {
+            double *row = data + y * step + x;
+            for(int yi = 0; yi < kernel_size; yi++, row += step)
+                for(int xi = 0; xi < kernel_size; xi++)
+                    row[xi] = row[xi] < threshold ? 0.0 : row[xi] - 1.0;
+            data[(y + half_kernel) * step + x + half_kernel] = 255.0;
+        });
+    }
 };
 
 class SITS : public surface {
@@ -76,6 +305,24 @@ class SITS : public surface {
         }
         c = maximum_value;
     }
+
+    template <typename iterator, typename = eventIterator<iterator>>
+    void update(iterator begin, iterator end)
+    {
+        const double maximum_value = kernel_size * kernel_size;
+        const size_t step = surf.step1();
+        double *data = surf.ptr<double>(0);
+        _each(begin, end, [&](int x, int y, double, int) {
+            //same order as the single update, the centre is decremented
+            //as it is passed
+            double &c = data[(y + half_kernel) * step + x + half_kernel];
+            double *column = data + y * step + x;
+            for(int xi = 0; xi < kernel_size; xi++, column++)
+                for(int yi = 0; yi < kernel_size; yi++)
+                    if(column[yi * step] >= c) column[yi * step]--;
+            c = maximum_value;
+        });
+    }
 };
 
 class PIM : public surface {
@@ -87,6 +334,16 @@ class PIM : public surface {
         else
             surf.at<double>(y+half_kernel, x+half_kernel) += 1.0f;
     }
+
+    template <typename iterator, typename = eventIterator<iterator>>
+    void update(iterator begin, iterator end)
+    {
+        const size_t step = surf.step1();
+        double *centre = surf.ptr<double>(half_kernel) + half_kernel;
+        _each(begin, end, [&](int x, int y, double, int p) {
+            centre[y * step + x] += p ? -1.0 : 1.0;
+        });
+    }
 };
 
 class SAE : public surface 
@@ -96,6 +353,17 @@ class SAE : public surface
     {
         surf.at<double>(y+half_kernel, x+half_kernel) = t;
     }
+
+    //t is the packet timestamp of each event (0 if the iterator has none)
+    template <typename iterator, typename = eventIterator<iterator>>
+    void update(iterator begin, iterator end)
+    {
+        const size_t step = surf.step1();
+        double *centre = surf.ptr<double>(half_kernel) + half_kernel;
+        _each(begin, end, [&](int x, int y, double t, int) {
+            centre[y * step + x] = t;
+        });
+    }
 };
 
 class BIN : public surface
@@ -105,6 +373,398 @@ class BIN : public surface
     {
         surf.at<double>(y+half_kernel, x+half_kernel) = 255.0;
     }
+
+    template <typename iterator, typename = eventIterator<iterator>>
+    void update(iterator begin, iterator end)
+    {
+        const size_t step = surf.step1();
+        double *centre = surf.ptr<double>(half_kernel) + half_kernel;
+        _each(begin, end, [&](int x, int y, double, int) {
+            centre[y * step + x] = 255.0;
+        });
+    }
+};
+
+/// \brief base of the lazily evaluated EROS and TOS. The decay of a pixel
+/// only depends on the number of events in its neighbourhood since it was
+/// set, so an event adds itself to the column counts of the kernel_size rows
+/// around it and stores the neighbourhood count of its own pixel: O(k) work
+/// instead of k*k read-modify-writes. The surface values are computed from
+/// the counts only when the surface (or a region of it) is read.
+class lazySurface
+{
+protected:
+    //the counts are rebased before they could wrap
+    static const uint32_t rebase_period = 1u << 30;
+
+    int kernel_size{0};
+    int half_kernel{0};
+    int width{0};
+    int height{0};
+    int stride{0};
+    uint32_t events{0};
+
+    std::vector<uint32_t> column;   //events within half_kernel rows (padded)
+    std::vector<uint32_t> baseline; //neighbourhood count when the pixel was set
+    std::vector<uint8_t> set;       //the pixel has had an event
+    std::vector<uint8_t> table;     //pixel value after n neighbourhood events
+
+    void _init(int width, int height, int kernel_size);
+    void _rebase();
+    void _row(int y, int x, int n, uint8_t *output) const;
+
+public:
+
+    inline void update(int x, int y, double t = 0, int p = 0)
+    {
+        (void)t; (void)p;
+        uint32_t *c = column.data() + y * stride + x + half_kernel;
+        for(int i = 0; i < kernel_size; i++, c += stride)
+            (*c)++;
+
+        //the event pixel is set after its own event decays the neighbourhood
+        const uint32_t *r = column.data() + (y + half_kernel) * stride + x;
+        uint32_t n = 0;
+        for(int i = 0; i < kernel_size; i++)
+            n += r[i];
+        size_t centre = (y + half_kernel) * stride + x + half_kernel;
+        baseline[centre] = n;
+        set[centre] = 1;
+
+        if(++events == rebase_period) _rebase();
+    }
+
+    template <typename iterator, typename = eventIterator<iterator>>
+    void update(iterator begin, iterator end)
+    {
+        for(; begin != end; begin++)
+            update(begin->x, begin->y);
+    }
+
+    cv::Mat getSurface();
+    cv::Mat getSurface(const cv::Rect &roi);
+};
+
+/// EROS evaluated when read (identical to EROS after conversion to CV_8U)
+class lazyEROS : public lazySurface
+{
+public:
+    void init(int width, int height, int kernel_size = 5, double parameter = 0.3);
+};
+
+/// TOS evaluated when read
+class lazyTOS : public lazySurface
+{
+public:
+    void init(int width, int height, int kernel_size = 5, double parameter = 2.0);
+};
+
+/// \brief the lazy form of surface::temporalDecay. Events store their time
+/// and the exponential decay of all pixels is computed in a single pass
+/// when the surface is read, instead of multiplying the surface each time.
+class lazyTimeSurface
+{
+protected:
+    int width{0};
+    int height{0};
+    std::vector<double> stamps;
+
+public:
+
+    void init(int width, int height);
+
+    inline void update(int x, int y, double ts, int p = 0)
+    {
+        (void)p;
+        stamps[y * width + x] = ts;
+    }
+
+    //255 * exp(alpha * (t_pixel - ts)), 0 for pixels without events
+    cv::Mat getSurface(double ts, double alpha);
+};
+
+/// \brief the time of the latest event (SAE) of C channels, such as the
+/// two polarities or the left and right cameras, in one cv::Mat with the
+/// channels of a pixel adjacent. An event, or a reader comparing channels,
+/// touches one cache line instead of one per channel surface. An event sets
+/// the kernel_size x kernel_size region around it in its own channel.
+template <int C = 2> class channelSurface
+{
+private:
+    int kernel_size{1};
+    int half_kernel{0};
+    size_t step{0};
+    double *data{nullptr};
+
+    cv::Rect actual_region;
+    cv::Mat surf;
+
+public:
+
+    void init(int width, int height, int kernel_size = 1)
+    {
+        if (kernel_size % 2 == 0)
+            kernel_size++;
+        this->kernel_size = kernel_size;
+        this->half_kernel = kernel_size / 2;
+        surf = cv::Mat(height + half_kernel * 2, width + half_kernel * 2, CV_64FC(C), cv::Scalar::all(0.0));
+        step = surf.step1();
+        data = surf.ptr<double>(0);
+        actual_region = {half_kernel, half_kernel, width, height};
+    }
+
+    //the channels of pixel (x, y): pixel(x, y)[c]
+    inline double* pixel(int x, int y)
+    {
+        return data + (y + half_kernel) * step + (x + half_kernel) * C;
+    }
+
+    inline double& at(int x, int y, int c)
+    {
+        return pixel(x, y)[c];
+    }
+
+    inline void update(int x, int y, double ts, int c)
+    {
+        double *row = data + y * step + x * C + c;
+        for(int yi = 0; yi < kernel_size; yi++, row += step)
+            for(int xi = 0; xi < kernel_size * C; xi += C)
+                row[xi] = ts;
+    }
+
+    //each event updates the channel of its polarity
+    template <typename iterator, typename = eventIterator<iterator>>
+    void update(iterator begin, iterator end)
+    {
+        for(; begin != end; begin++)
+            update(begin->x, begin->y, eventTime(begin), eventPolarity(*begin));
+    }
+
+    //each event updates channel(event), e.g. [](const AE &v){return v.channel;}
+    template <typename iterator, typename F, typename = eventIterator<iterator>>
+    void update(iterator begin, iterator end, F channel)
+    {
+        for(; begin != end; begin++)
+            update(begin->x, begin->y, eventTime(begin), channel(*begin));
+    }
+
+    //all channels (CV_64FC(C)), sharing memory with the surface
+    cv::Mat getSurface()
+    {
+        return surf(actual_region);
+    }
+
+    //a copy of a single channel (CV_64F)
+    cv::Mat getChannel(int c)
+    {
+        cv::Mat output;
+        cv::extractChannel(surf(actual_region), output, c);
+        return output;
+    }
+};
+
+/// \brief passes copies of a surface from the thread updating it to a thread
+/// reading it (triple buffering). The writer copies into its own buffer and
+/// swaps it with the shared one, the reader swaps the shared one with its own
+/// buffer only if a newer copy exists. Neither side waits for the other and
+/// the reader never sees a partially written surface. One writer thread and
+/// one reader thread.
+class surfaceBuffer
+{
+private:
+    //bit 2 of shared is set when the writer has published since the last swap
+    static const int fresh = 4;
+
+    cv::Mat buffers[3];
+    uint64_t epochs[3]{0, 0, 0};
+    int back{0};
+    int front{1};
+    std::atomic<int> shared{2};
+    uint64_t published{0};
+
+    //only used to wake a waiting reader
+    std::mutex m;
+    std::condition_variable signal;
+    bool interrupted{false};
+
+public:
+
+    //allocate all buffers (zeros) so the reader has a valid surface before
+    //the first publish
+    void init(cv::Size size, int type);
+
+    //writer: copy the current surface and make it available to the reader
+    void publish(const cv::Mat &surface);
+
+    //writer: the reader has taken the last published surface (or none has
+    //been published). Publishing only then skips copies it would never see
+    bool taken() const { return !(shared.load(std::memory_order_acquire) & fresh); }
+
+    //reader: the most recently published surface. Valid until the next call
+    const cv::Mat& snapshot();
+
+    //reader: the number of publishes up to the current snapshot (0 = none).
+    //an unchanged epoch means the snapshot has not changed
+    uint64_t epoch() const { return epochs[front]; }
+
+    //reader: sleep until a surface newer than the snapshot is published.
+    //Returns false once interrupted
+    bool wait();
+
+    //wake the reader (e.g. to stop its thread), any later wait returns false
+    void interrupt();
+};
+
+/// \brief updates a surface (EROS, TOS, SITS, PIM, SAE, BIN or fastEROS)
+/// with several threads. The image is split into strips of full rows, at
+/// least kernel_size tall, so the kernel of an event only reaches its own
+/// strip and the next one. A batch is bucketed by strip, then the even
+/// strips are updated in parallel, followed by the odd strips, so no two
+/// threads write the same pixel. Events are applied in input order within a
+/// strip and the result does not depend on the number of threads.
+template <typename S> class tiledSurface
+{
+private:
+
+    //smaller batches are updated by the calling thread only
+    static const size_t min_parallel = 2048;
+
+    typedef struct {
+        uint16_t x;
+        uint16_t y;
+        uint8_t p;
+        double ts;
+    } stripEvent;
+
+    //iterator over the events of a strip, with a timestamp per event
+    class stripIterator
+    {
+    private:
+        const stripEvent *e;
+    public:
+        stripIterator(const stripEvent *e) : e(e) {}
+        const stripEvent* operator->() const { return e; }
+        const stripEvent& operator*() const { return *e; }
+        stripIterator& operator++() { e++; return *this; }
+        stripIterator operator++(int) { stripIterator i = *this; e++; return i; }
+        bool operator!=(const stripIterator &other) const { return e != other.e; }
+        double timestamp() const { return e->ts; }
+    };
+
+    S surf;
+    int strip_rows{32};
+    std::vector< std::vector<stripEvent> > strips;
+
+    std::vector<std::thread> workers;
+    std::mutex m;
+    std::condition_variable start_signal;
+    std::condition_variable done_signal;
+    unsigned int generation{0};
+    int phase{0};
+    int busy{0};
+    bool stopping{false};
+    std::atomic<int> next{0};
+
+    //update the strips of this phase (0 even, 1 odd) until none are left
+    void _updateStrips(int phase)
+    {
+        int n = ((int)strips.size() - phase + 1) / 2;
+        for(int i = next++; i < n; i = next++) {
+            const std::vector<stripEvent> &strip = strips[2 * i + phase];
+            surf.update(stripIterator(strip.data()), stripIterator(strip.data() + strip.size()));
+        }
+    }
+
+    void _worker()
+    {
+        unsigned int done = 0;
+        std::unique_lock<std::mutex> lk(m);
+        while(true) {
+            start_signal.wait(lk, [&]{return stopping || generation != done;});
+            if(stopping) return;
+            done = generation;
+            int p = phase;
+            lk.unlock();
+            _updateStrips(p);
+            lk.lock();
+            if(--busy == 0) done_signal.notify_one();
+        }
+    }
+
+    void _runPhase(int p, bool parallel)
+    {
+        next = 0;
+        if(!parallel || workers.empty()) {
+            _updateStrips(p);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lk(m);
+            phase = p;
+            busy = workers.size();
+            generation++;
+        }
+        start_signal.notify_all();
+        _updateStrips(p);
+        std::unique_lock<std::mutex> lk(m);
+        done_signal.wait(lk, [this]{return busy == 0;});
+    }
+
+    void _stop()
+    {
+        {
+            std::lock_guard<std::mutex> lk(m);
+            stopping = true;
+        }
+        start_signal.notify_all();
+        for(auto &w : workers) w.join();
+        workers.clear();
+        stopping = false;
+    }
+
+public:
+
+    ~tiledSurface()
+    {
+        _stop();
+    }
+
+    //threads: workers as well as the calling thread (-1 = one per core)
+    void init(int width, int height, int kernel_size = 5, double parameter = 0.0, int threads = -1, int strip_rows = 32)
+    {
+        _stop();
+        surf.init(width, height, kernel_size, parameter);
+        if (kernel_size % 2 == 0)
+            kernel_size++;
+        this->strip_rows = std::max(strip_rows, kernel_size);
+        strips.clear();
+        strips.resize((height + this->strip_rows - 1) / this->strip_rows);
+
+        //no more threads than the strips of a phase
+        if(threads < 0)
+            threads = std::max((int)std::thread::hardware_concurrency() - 1, 0);
+        threads = std::min(threads, (int)(strips.size() + 1) / 2 - 1);
+        for(int i = 0; i < threads; i++)
+            workers.emplace_back([this]{_worker();});
+    }
+
+    template <typename iterator, typename = eventIterator<iterator>>
+    void update(iterator begin, iterator end)
+    {
+        for(auto &strip : strips) strip.clear();
+        size_t n = 0;
+        for(; begin != end; begin++, n++)
+            strips[begin->y / strip_rows].push_back({(uint16_t)begin->x, (uint16_t)begin->y,
+                (uint8_t)eventPolarity(*begin), eventTime(begin)});
+
+        _runPhase(0, n >= min_parallel);
+        _runPhase(1, n >= min_parallel);
+    }
+
+    cv::Mat getSurface()
+    {
+        return surf.getSurface();
+    }
 };
 
 // Set of Centre Active Receptive Fields
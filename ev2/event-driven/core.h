@@ -1,3 +1,7 @@
 #include "core/comms.h"
 #include "core/utilities.h"
 #include "core/codec.h"
+#include "core/pool.h"
+#include "core/shm.h"
+#include "core/arrays.h"
+#include "core/telemetry.h"
@@ -0,0 +1,111 @@
+/*
+ *   Copyright (C) 2021 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include "pool.h"
+
+namespace ev {
+
+/// \brief address events stored as separate contiguous arrays (a structure
+/// of arrays). The bitfields of each event are decoded once when the events
+/// are appended, so algorithms can then loop over one field of many events
+/// with plain (vectorisable) loads. ts holds zeros if ENABLE_TS is off.
+/// S is the stamp type: ev::eventArrays (32 bit) for AE and flowEvent,
+/// ev::longEventArrays (64 bit) for longAE. A narrower stamp than the events
+/// carry does not compile.
+template <typename S> class basicEventArrays
+{
+public:
+
+    typedef S stamp;
+
+    pooledBuffer<uint16_t> x;
+    pooledBuffer<uint16_t> y;
+    pooledBuffer<uint8_t>  p;
+    pooledBuffer<S> ts;
+
+    size_t size() const { return x.size(); }
+    bool empty() const { return x.empty(); }
+
+    //remove the events but keep the memory for the next append
+    void clear()
+    {
+        resize(0);
+    }
+
+    void resize(size_t n)
+    {
+        x.resize(n);
+        y.resize(n);
+        p.resize(n);
+        ts.resize(n);
+    }
+
+    //append n contiguous events of an address event type (AE, flowEvent)
+    template <typename T> void append(const T *events, size_t n)
+    {
+        static_assert(sizeof(S) >= sizeof(decltype(T::ts)), "stamp type narrower than the event timestamp");
+        size_t offset = size();
+        resize(offset + n);
+        uint16_t *xo = x.data() + offset;
+        uint16_t *yo = y.data() + offset;
+        uint8_t  *po = p.data() + offset;
+        S *to = ts.data() + offset;
+        for(size_t i = 0; i < n; i++) {
+            xo[i] = events[i].x;
+            yo[i] = events[i].y;
+            po[i] = events[i].p;
+            to[i] = events[i].ts;
+        }
+    }
+
+    //append the events of any iterator range (e.g. ev::ringWindow)
+    template <typename iterator> void append(iterator begin, iterator end)
+    {
+        static_assert(sizeof(S) >= sizeof(decltype(begin->ts)), "stamp type narrower than the event timestamp");
+        for(; begin != end; begin++) {
+            x.push_back(begin->x);
+            y.push_back(begin->y);
+            p.push_back(begin->p);
+            ts.push_back((S)begin->ts);
+        }
+    }
+
+    //write the events back as an address event type. Fields that are not
+    //stored (e.g. channel) are zero
+    template <typename T> void extract(T *events) const
+    {
+        for(size_t i = 0; i < size(); i++) {
+            events[i] = T();
+            events[i].x = x[i];
+            events[i].y = y[i];
+            events[i].p = p[i];
+#if ENABLE_TS
+            events[i].ts = ts[i];
+#endif
+        }
+    }
+};
+
+typedef basicEventArrays<uint32_t> eventArrays;
+typedef basicEventArrays<uint64_t> longEventArrays;
+
+}
@@ -20,6 +20,7 @@
 
 const std::string ev::timeStamp::tag = "TS";
 const std::string ev::addressEvent::tag = "AE";
+const std::string ev::longAE::tag = "AE64";
 const std::string ev::encoded::tag="AE";
 const std::string ev::skinAE::tag = "AE";
 const std::string ev::skinSample::tag = "SKS";
@@ -27,4 +28,88 @@ const std::string ev::flowEvent::tag = "FLOW";
 const std::string ev::gaussianEvent::tag = "GAE";
 const std::string ev::IMUS::tag = "IMU";
 const std::string ev::neuronEvent::tag = "NEU";
-const std::string ev::earEvent::tag = "EAR";
\ No newline at end of file
+const std::string ev::earEvent::tag = "EAR";
+
+namespace {
+
+inline uint8_t* putVarint(uint8_t *out, uint32_t v)
+{
+    while(v >= 0x80) {
+        *out++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *out++ = (uint8_t)v;
+    return out;
+}
+
+inline const uint8_t* getVarint(const uint8_t *in, const uint8_t *end, uint32_t &v)
+{
+    v = 0;
+    for(unsigned int shift = 0; in < end && shift < 35; shift += 7) {
+        uint8_t b = *in++;
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if(!(b & 0x80)) return in;
+    }
+    return nullptr;
+}
+
+inline uint32_t zigzag(uint32_t delta)
+{
+    return (delta << 1) ^ (uint32_t)((int32_t)delta >> 31);
+}
+
+inline uint32_t unzigzag(uint32_t v)
+{
+    return (v >> 1) ^ (uint32_t)(-(int32_t)(v & 1));
+}
+
+}
+
+size_t ev::compressEvents(const uint32_t *events, size_t n_events, unsigned int stride, std::vector<uint8_t> &out)
+{
+    //worst case is 5 bytes per word. out is only grown so it can be reused
+    size_t worst = 5 + n_events * stride * 5;
+    if(out.size() < worst) out.resize(worst);
+    uint8_t *o = putVarint(out.data(), (uint32_t)n_events);
+
+    std::vector<uint32_t> previous(stride, 0);
+    for(size_t i = 0; i < n_events; i++) {
+        for(unsigned int w = 0; w < stride; w++) {
+            uint32_t word = *events++;
+            o = putVarint(o, zigzag(word - previous[w]));
+            previous[w] = word;
+        }
+    }
+    return o - out.data();
+}
+
+bool ev::compressedCount(const uint8_t *data, size_t n_bytes, unsigned int stride, size_t &n_events)
+{
+    uint32_t n = 0;
+    if(!getVarint(data, data + n_bytes, n)) return false;
+    //every word takes at least one byte, so a larger count is corrupt and
+    //must not be used to size the output buffer
+    if(!stride || n > n_bytes / stride) return false;
+    n_events = n;
+    return true;
+}
+
+bool ev::decompressEvents(const uint8_t *data, size_t n_bytes, unsigned int stride, uint32_t *events, size_t n_events)
+{
+    const uint8_t *end = data + n_bytes;
+    uint32_t n = 0;
+    data = getVarint(data, end, n);
+    if(!data || n != n_events) return false;
+
+    std::vector<uint32_t> previous(stride, 0);
+    for(size_t i = 0; i < n_events; i++) {
+        for(unsigned int w = 0; w < stride; w++) {
+            uint32_t v = 0;
+            data = getVarint(data, end, v);
+            if(!data) return false;
+            previous[w] += unzigzag(v);
+            *events++ = previous[w];
+        }
+    }
+    return data == end;
+}
@@ -17,5 +17,90 @@
  */
 
 #include <event-driven/core/comms.h>
+#include <yarp/os/LogStream.h>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace ev {
+
+//memory shared between both halves of the mirror, closed once mapped
+static int mirrorMemory(size_t bytes)
+{
+#ifdef __linux__
+    int fd = memfd_create("ev::ringWindow", 0);
+#else
+    //an anonymous POSIX shared memory object
+    std::string name = "/ev.mirror." + std::to_string(getpid()) + "." +
+                       std::to_string((uintptr_t)&bytes);
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if(fd >= 0) shm_unlink(name.c_str());
+#endif
+    if(fd < 0) return -1;
+    if(ftruncate(fd, bytes) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void* mirrorAllocate(size_t bytes)
+{
+    int fd = mirrorMemory(bytes);
+    if(fd < 0) return nullptr;
+
+    //reserve twice the space and map the same memory in both halves
+    char *base = (char *)mmap(nullptr, 2 * bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(base == MAP_FAILED) {
+        ::close(fd);
+        return nullptr;
+    }
+    if(mmap(base, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+       mmap(base + bytes, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, 2 * bytes);
+        ::close(fd);
+        return nullptr;
+    }
+    ::close(fd);
+    return base;
+}
+
+void mirrorFree(void *mirror, size_t bytes)
+{
+    munmap(mirror, 2 * bytes);
+}
+
+void* mapFile(const std::string &path, size_t &bytes)
+{
+    bytes = 0;
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) return nullptr;
+
+    struct stat st;
+    if(fstat(fd, &st) < 0 || st.st_size == 0) {
+        ::close(fd);
+        return nullptr;
+    }
+    void *mapping = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(mapping == MAP_FAILED) {
+        yError() << "Could not map" << path << ":" << std::strerror(errno);
+        return nullptr;
+    }
+    madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+    bytes = st.st_size;
+    return mapping;
+}
+
+void unmapFile(void *mapping, size_t bytes)
+{
+    munmap(mapping, bytes);
+}
+
+}
 
 
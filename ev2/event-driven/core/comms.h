@@ -23,6 +23,7 @@
 #include <yarp/os/ConnectionWriter.h>
 #include <yarp/os/LogStream.h>
 #include <yarp/os/Stamp.h>
+#include <yarp/os/Time.h>
 #include <vector>
 #include <deque>
 #include <list>
@@ -31,7 +32,24 @@
 #include <mutex>
 #include <iomanip>
 #include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <ctime>
 #include <fstream>
+#include <algorithm>
+#include <cfloat>
+#include <memory>
+#include <utility>
+#include <atomic>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#include "utilities.h"
+#include "pool.h"
+#include "shm.h"
+#include "arrays.h"
+#include "telemetry.h"
 
 namespace ev {
 
@@ -42,16 +60,24 @@ typedef struct
     double timestamp;
 } info;
 
+/// how the events of a packet are sent: as they are, compressed, or as a
+/// reference to shared memory
+enum class payload { raw, compressed, shared };
+
 
 template <typename T> class packet : public yarp::os::Portable {
 
 private:
     unsigned int n_elements{0};
-    std::vector<T> buffer;
+    //storage comes from the shared pool and is not zeroed when grown, each
+    //received event is written once
+    pooledBuffer<T> buffer;
     double _duration{0.0};
     yarp::os::Stamp e;
+    bool _compress{false};
+    mutable std::vector<uint8_t> wire;
 
-    bool invalidPacket(const std::string &msg) const
+    static bool invalidPacket(const std::string &msg)
     {
         yError() << "Invalid Packet:" << msg;
         return false;
@@ -59,19 +85,113 @@ private:
 
 public:
 
-    bool read(yarp::os::ConnectionReader &reader) override
+    //compressed and shared memory packets are sent with these tags so
+    //readers can detect them
+    static const std::string& compressedTag()
+    {
+        static const std::string tag = T::tag + "-z";
+        return tag;
+    }
+
+    static const std::string& sharedTag()
+    {
+        static const std::string tag = T::tag + "-shm";
+        return tag;
+    }
+
+    //parse the Bottle-compatible header, leaving n_bytes of payload to read
+    static bool readHeader(yarp::os::ConnectionReader &reader, double &duration, int &n_bytes, payload &format)
     {
         int32_t r = reader.expectInt32();
         if(r == 0) return false;
         else if(r != BOTTLE_TAG_LIST) return invalidPacket("not a list");
         if(reader.expectInt32() != 3) return invalidPacket("not 3 elements");
         if(reader.expectInt32() != BOTTLE_TAG_STRING) return invalidPacket("no tag");
-        if(reader.expectString() != T::tag) return invalidPacket("incorrect tag");
+        std::string tag = reader.expectString();
+        if(tag == T::tag) format = payload::raw;
+        else if(tag == compressedTag()) format = payload::compressed;
+        else if(tag == sharedTag()) format = payload::shared;
+        else return invalidPacket("incorrect tag");
         if(reader.expectInt32() != BOTTLE_TAG_INT32) return invalidPacket("no duration");
-        _duration = reader.expectInt32() * 0.000001;
+        duration = reader.expectInt32() * 0.000001;
         if(reader.expectInt32() != BOTTLE_TAG_STRING) return invalidPacket("no data");
-        int n = reader.expectInt32(); // STRING_LENGTH
-        if(n % sizeof(T)) return invalidPacket("data invalid length");
+        n_bytes = reader.expectInt32(); // STRING_LENGTH
+        if(format == payload::raw && n_bytes % sizeof(T)) return invalidPacket("data invalid length");
+        if(format == payload::shared && n_bytes != sizeof(shmReference)) return invalidPacket("invalid shared memory reference");
+        return true;
+    }
+
+    //read a shared memory reference payload
+    static bool readReference(yarp::os::ConnectionReader &reader, shmReference &reference)
+    {
+        if(!reader.expectBlock((char *)&reference, sizeof(shmReference))) return false;
+        reference.segment[sizeof(reference.segment) - 1] = '\0';
+        return true;
+    }
+
+    //the mapping holding the referenced events, held while they are copied.
+    //nullptr if it cannot be attached or the reference does not fit in it
+    static std::shared_ptr<const shmRing> referencedRing(const shmReference &reference)
+    {
+        std::shared_ptr<const shmRing> ring = shmRing::attached(reference.segment, reference.generation);
+        if(!ring) {
+            yError() << "Could not attach to shared memory" << reference.segment;
+            return nullptr;
+        }
+        if(reference.count > ring->getCapacity() / sizeof(T)) {
+            invalidPacket("shared memory reference larger than the segment");
+            return nullptr;
+        }
+        return ring;
+    }
+
+    //copy referenced events from shared memory. Returns false if they were
+    //overwritten before being read or belong to a previous writer
+    static bool readShared(const shmRing &ring, const shmReference &reference, T *destination)
+    {
+        if(ring.getGeneration() != reference.generation) return false;
+        return ring.read(reference.position, destination, reference.count * sizeof(T));
+    }
+
+    //read a compressed payload of n_bytes into the scratch buffer and return
+    //the number of events it holds
+    static bool readCompressed(yarp::os::ConnectionReader &reader, int n_bytes, std::vector<uint8_t> &scratch, size_t &n_events)
+    {
+        if(scratch.size() < (size_t)n_bytes) scratch.resize(n_bytes);
+        if(!reader.expectBlock((char *)scratch.data(), n_bytes)) return false;
+        if(!compressedCount(scratch.data(), n_bytes, sizeof(T) / sizeof(uint32_t), n_events)) return invalidPacket("corrupt compressed data");
+        return true;
+    }
+
+    bool read(yarp::os::ConnectionReader &reader) override
+    {
+        int n = 0;
+        payload format = payload::raw;
+        if(!readHeader(reader, _duration, n, format)) return false;
+
+        //an unreadable or overwritten shared packet is returned empty
+        if(format == payload::shared) {
+            shmReference reference;
+            if(!readReference(reader, reference)) return false;
+            n_elements = 0;
+            std::shared_ptr<const shmRing> ring = referencedRing(reference);
+            if(!ring) return true;
+            if(buffer.size() < reference.count) buffer.resize(reference.count);
+            if(readShared(*ring, reference, buffer.data()))
+                n_elements = reference.count;
+            return true;
+        }
+
+        if(format == payload::compressed) {
+            size_t count = 0;
+            if(!readCompressed(reader, n, wire, count)) return false;
+            n_elements = count;
+            if(buffer.size() < n_elements) buffer.resize(n_elements);
+            if(!decompressEvents(wire.data(), n, sizeof(T) / sizeof(uint32_t), (uint32_t *)buffer.data(), n_elements))
+                return invalidPacket("corrupt compressed data");
+            return true;
+        }
+
         n_elements = n / sizeof(T);
         if(buffer.size() < n_elements) buffer.resize(n_elements);
         return reader.expectBlock((char *)buffer.data(), n);
@@ -84,19 +204,40 @@ public:
             return true;
         }
 
+        const std::string *tag = &T::tag;
+        const char *payload = (const char *)buffer.data();
+        size_t n_bytes = n_elements * sizeof(T);
+        if(_compress && sizeof(T) % sizeof(uint32_t) == 0) {
+            tag = &compressedTag();
+            n_bytes = compressEvents((const uint32_t *)buffer.data(), n_elements, sizeof(T) / sizeof(uint32_t), wire);
+            payload = (const char *)wire.data();
+        }
+
         writer.appendInt32(BOTTLE_TAG_LIST);
         writer.appendInt32(3);
         writer.appendInt32(BOTTLE_TAG_STRING);
-        writer.appendInt32(T::tag.length());
-        writer.appendExternalBlock(T::tag.c_str(), T::tag.length());
+        writer.appendInt32(tag->length());
+        writer.appendExternalBlock(tag->c_str(), tag->length());
         writer.appendInt32(BOTTLE_TAG_INT32);
         writer.appendInt32((int)(_duration * 1000000 + 0.5));
         writer.appendInt32(BOTTLE_TAG_STRING);
-        writer.appendInt32(n_elements * sizeof(T));
-        writer.appendExternalBlock((char *)buffer.data(), n_elements * sizeof(T));
+        writer.appendInt32(n_bytes);
+        writer.appendExternalBlock(payload, n_bytes);
         return !writer.isError();
     }
 
+    //send the events delta/varint compressed (see ev::compressEvents).
+    //Readers detect compressed packets and decode them transparently
+    void compression(bool enable)
+    {
+        _compress = enable;
+    }
+
+    bool compression(void) const
+    {
+        return _compress;
+    }
+
     void clear(void)
     {
         n_elements = 0;
@@ -106,18 +247,18 @@ public:
     void push_back(const T &element)
     {
         if(buffer.size() <= n_elements)
-            buffer.resize(buffer.size() + 16384);
+            buffer.resize(std::max(buffer.size() * 2, (size_t)16384));
         buffer[n_elements++] = element;
     }
 
-    using iterator = typename std::vector<T>::iterator;
+    using iterator = typename pooledBuffer<T>::iterator;
 
-    typename std::vector<T>::iterator begin()
+    typename pooledBuffer<T>::iterator begin()
     {
         return buffer.begin();
     }
 
-    typename std::vector<T>::iterator end()
+    typename pooledBuffer<T>::iterator end()
     {
         return buffer.begin() + n_elements;
     }
@@ -137,6 +278,12 @@ public:
         buffer.resize(n);
     }
 
+    //keep only the first n events
+    void truncate(size_t n)
+    {
+        if(n < n_elements) n_elements = n;
+    }
+
     void duration(const double &seconds)
     {
         _duration = seconds;
@@ -236,16 +383,268 @@ public:
 
 };
 
+/// \brief a packet published through shared memory. Only the reference to
+/// its events is sent, ev::packet reads it as a normal packet.
+template <typename T> class shmPacket : public yarp::os::Portable
+{
+public:
+
+    shmReference reference;
+    double duration{0.0};
+
+    bool read(yarp::os::ConnectionReader &reader) override
+    {
+        return false;
+    }
+
+    bool write(yarp::os::ConnectionWriter &writer) const override
+    {
+        const std::string &tag = packet<T>::sharedTag();
+        writer.appendInt32(BOTTLE_TAG_LIST);
+        writer.appendInt32(3);
+        writer.appendInt32(BOTTLE_TAG_STRING);
+        writer.appendInt32(tag.length());
+        writer.appendExternalBlock(tag.c_str(), tag.length());
+        writer.appendInt32(BOTTLE_TAG_INT32);
+        writer.appendInt32((int)(duration * 1000000 + 0.5));
+        writer.appendInt32(BOTTLE_TAG_STRING);
+        writer.appendInt32(sizeof(shmReference));
+        writer.appendExternalBlock((const char *)&reference, sizeof(shmReference));
+        return !writer.isError();
+    }
+};
+
+/// \brief a sequence counter the consumer can sleep on. The producer only
+/// makes a system call when the consumer is actually waiting.
+class eventSignal
+{
+private:
+
+    std::atomic<uint32_t> sequence{0};
+    std::atomic<bool> waiting{false};
+#ifndef __linux__
+    std::mutex m;
+    std::condition_variable cv;
+#endif
+
+public:
+
+    //producer: call after publishing data
+    void notify()
+    {
+        sequence.fetch_add(1);
+        if(!waiting.load()) return;
+#ifdef __linux__
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&sequence), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+        std::lock_guard<std::mutex> lk(m);
+        cv.notify_one();
+#endif
+    }
+
+    //consumer: check the condition (after consuming any data) until it is
+    //true. Sleeps only if nothing has been published since it was checked
+    template <typename C> void wait(C condition)
+    {
+        while(true) {
+            waiting.store(true);
+            uint32_t s = sequence.load();
+            if(condition()) break;
+#ifdef __linux__
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&sequence), FUTEX_WAIT_PRIVATE, s, nullptr, nullptr, 0);
+#else
+            std::unique_lock<std::mutex> lk(m);
+            cv.wait(lk, [this, s]{return sequence.load() != s;});
+#endif
+        }
+        waiting.store(false);
+    }
+
+    //consumer: as wait() but gives up after the given seconds. Returns the
+    //last result of the condition
+    template <typename C> bool waitFor(double seconds, C condition)
+    {
+        auto deadline = std::chrono::steady_clock::now() +
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+        bool result = false;
+        while(true) {
+            waiting.store(true);
+            uint32_t s = sequence.load();
+            if((result = condition())) break;
+            auto remaining = deadline - std::chrono::steady_clock::now();
+            if(remaining <= std::chrono::steady_clock::duration::zero()) break;
+#ifdef __linux__
+            long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(remaining).count();
+            struct timespec ts = {(time_t)(ns / 1000000000), (long)(ns % 1000000000)};
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&sequence), FUTEX_WAIT_PRIVATE, s, &ts, nullptr, 0);
+#else
+            std::unique_lock<std::mutex> lk(m);
+            cv.wait_until(lk, deadline, [this, s]{return sequence.load() != s;});
+#endif
+        }
+        waiting.store(false);
+        return result;
+    }
+};
+
+/// what ev::BufferedPort::write does when the previous packet is still
+/// being sent: wait for it (block), merge the packet into the next one
+/// (coalesce), discard it for the next one (drop, oldest data is lost), or
+/// keep every factor-th event and merge it into the next one (subsample).
+/// A held packet that reaches the port's limit is dropped, so a stalled
+/// reader cannot grow it without bound
+enum class overload { block, coalesce, drop, subsample };
+
+typedef struct
+{
+    unsigned int written;   //packets sent
+    unsigned int blocked;   //writes that waited for the previous packet
+    unsigned int coalesced; //writes held back while the port was busy
+    unsigned int dropped;   //events discarded (drop and subsample)
+} writeStats;
+
+/// \brief packets drained together by ev::BufferedPort::readBatch. The
+/// packets remain valid until the next read from the port.
+template <typename T> struct packetBatch
+{
+    std::vector< packet<T>* > packets;
+    yarp::os::Stamp first; //envelope of the first packet
+    yarp::os::Stamp last;  //envelope of the last packet
+    info stats{0};         //total events and duration, last timestamp
+
+    typename std::vector< packet<T>* >::const_iterator begin() const { return packets.begin(); }
+    typename std::vector< packet<T>* >::const_iterator end() const { return packets.end(); }
+    size_t size() const { return packets.size(); }
+    bool empty() const { return packets.empty(); }
+};
+
 /// vPortWrapper forces uses in a way to avoid
 template <typename T> class BufferedPort : protected yarp::os::BufferedPort< ev::packet<T> >
 {
 private:
     ev::packet<T> *prepared = nullptr;
+    bool compress{false};
+    overload policy{overload::block};
+    unsigned int factor{2};
+    size_t limit{1 << 20};
+    //updated by the writing thread, read and reset by getWriteStats()
+    struct
+    {
+        std::atomic<unsigned int> written{0};
+        std::atomic<unsigned int> blocked{0};
+        std::atomic<unsigned int> coalesced{0};
+        std::atomic<unsigned int> dropped{0};
+    } counters;
+    //a prepared packet held back by the overload policy
+    bool pending{false};
+    double pending_duration{0.0};
+    size_t subsampled{0};
+    packetBatch<T> batch;
+    std::vector<void *> held;
+    //packets handed over by the port's callback thread, and their handles
+    struct arrival
+    {
+        ev::packet<T> *p;
+        void *handle;
+    };
+    std::deque<arrival> arrivals;
+    std::mutex arrivals_m;
+    eventSignal arrived;
+    std::atomic<bool> interrupted{false};
+    std::unique_ptr<shmRing> shm;
+    std::unique_ptr< yarp::os::BufferedPort< shmPacket<T> > > shm_port;
+    portTelemetry telemetry;
+
+    //copy the events to shared memory and send the reference
+    void _writeShared(ev::packet<T> &p)
+    {
+        if(!shm_port->getOutputCount() || !p.size()) return;
+        shmPacket<T> &s = shm_port->prepare();
+        if(!shm->write(&p[0], p.size() * sizeof(T), s.reference.position)) {
+            yWarning() << "packet larger than shared memory, not sent on" << shm_port->getName();
+            shm_port->unprepare();
+            return;
+        }
+        strncpy(s.reference.segment, shm->getName().c_str(), sizeof(s.reference.segment) - 1);
+        s.reference.segment[sizeof(s.reference.segment) - 1] = '\0';
+        s.reference.generation = shm->getGeneration();
+        s.reference.count = p.size();
+        s.duration = p.duration();
+        shm_port->setEnvelope(p.envelope());
+        //never wait for a slow reader. One that falls a ring behind finds
+        //its reference overwritten and reads an empty packet
+        shm_port->write();
+    }
+
+    //the port's callback thread: keep the packet until it is read
+    void onRead(ev::packet<T> &p) override
+    {
+        yarp::os::BufferedPort< ev::packet<T> >::getEnvelope(p.envelope());
+        void *handle = yarp::os::BufferedPort< ev::packet<T> >::acquire();
+        {
+            std::lock_guard<std::mutex> lk(arrivals_m);
+            arrivals.push_back({&p, handle});
+        }
+        arrived.notify();
+    }
+
+    bool _pop(arrival &a)
+    {
+        std::lock_guard<std::mutex> lk(arrivals_m);
+        if(arrivals.empty()) return false;
+        a = arrivals.front();
+        arrivals.pop_front();
+        return true;
+    }
+
+    //the next packet, held until the next read. Waits up to timeout seconds
+    //(negative waits until a packet arrives, interrupt() or close())
+    ev::packet<T>* _read(double timeout)
+    {
+        arrival a{nullptr, nullptr};
+        auto ready = [this, &a]{return _pop(a) || interrupted || this->isClosed();};
+        if(timeout < 0) arrived.wait(ready);
+        else if(timeout > 0) arrived.waitFor(timeout, ready);
+        else _pop(a);
+
+        if(!a.p) return nullptr;
+        held.push_back(a.handle);
+        telemetry.record(a.p->size(), a.p->timestamp());
+        return a.p;
+    }
+
+    size_t _pending()
+    {
+        std::lock_guard<std::mutex> lk(arrivals_m);
+        return arrivals.size();
+    }
+
+    //give the packets of the last batch back to the port
+    void _releaseBatch()
+    {
+        for(auto h : held)
+            yarp::os::BufferedPort< ev::packet<T> >::release(h);
+        held.clear();
+        batch.packets.clear();
+        batch.stats = {0, 0, 0};
+    }
+
 public:
 
     BufferedPort()
     {
         yarp::os::BufferedPort< ev::packet<T> >::setStrict();
+        yarp::os::BufferedPort< ev::packet<T> >::useCallback();
+    }
+
+    ~BufferedPort()
+    {
+        //no more callbacks once closed
+        yarp::os::BufferedPort< ev::packet<T> >::close();
+        _releaseBatch();
+        for(auto &a : arrivals)
+            yarp::os::BufferedPort< ev::packet<T> >::release(a.handle);
+        if(shm_port) shm_port->close();
     }
 
     void write()
@@ -260,42 +659,281 @@ public:
                         "Nothing written";
             return;
         }
+
+        //the consumer is still receiving the previous packet
+        if(policy != overload::block && yarp::os::BufferedPort< ev::packet<T> >::isWriting()) {
+            if(policy == overload::subsample) {
+                size_t kept = subsampled;
+                for(size_t i = subsampled; i < prepared->size(); i += factor)
+                    (*prepared)[kept++] = (*prepared)[i];
+                counters.dropped += prepared->size() - kept;
+                prepared->truncate(kept);
+                subsampled = kept;
+            }
+            pending_duration += prepared->duration();
+            counters.coalesced++;
+            pending = true;
+            return;
+        }
+
+        if(pending) {
+            prepared->duration(prepared->duration() + pending_duration);
+            pending = false;
+            pending_duration = 0.0;
+            subsampled = 0;
+        } else if(yarp::os::BufferedPort< ev::packet<T> >::isWriting()) {
+            counters.blocked++;
+        }
+
+        prepared->compression(compress);
+        if(shm_port) _writeShared(*prepared);
         yarp::os::BufferedPort< ev::packet<T> >::setEnvelope(prepared->envelope());
         yarp::os::BufferedPort< ev::packet<T> >::waitForWrite(); 
         yarp::os::BufferedPort< ev::packet<T> >::writeStrict();
+        telemetry.record(prepared->size());
+        counters.written++;
         prepared = nullptr;
     }
 
+    //a packet to fill and write. If the overload policy held back the last
+    //packet its events are still here (except with overload::drop)
     ev::packet<T>& prepare() 
     {
         auto &p = yarp::os::BufferedPort< ev::packet<T> >::prepare();
-        p.clear();
+        if(pending && (policy == overload::drop || p.size() >= limit)) {
+            counters.dropped += p.size();
+            pending = false;
+            pending_duration = 0.0;
+            subsampled = 0;
+        }
+        if(!pending) p.clear();
         prepared = &p;
         return p;
     }
 
+    //what write() does if the previous packet is still being sent. The
+    //default (block) waits, the others never block the writing thread. A
+    //held packet of limit events or more is dropped at the next prepare()
+    void setOverloadPolicy(overload policy, unsigned int factor = 2, size_t limit = 1 << 20)
+    {
+        this->policy = policy;
+        this->factor = std::max(factor, 1u);
+        this->limit = std::max(limit, (size_t)1);
+    }
+
+    //counts of the overload policy actions since the last call (safe to
+    //call from a thread other than the writer)
+    writeStats getWriteStats()
+    {
+        writeStats current;
+        current.written = counters.written.exchange(0);
+        current.blocked = counters.blocked.exchange(0);
+        current.coalesced = counters.coalesced.exchange(0);
+        current.dropped = counters.dropped.exchange(0);
+        return current;
+    }
+
+    //compress the packets written by this port (1.8x to 4x for AE, see
+    //ev::compressEvents). Any ev:: reader decodes them, but readers built
+    //before compression was added will reject them
+    void setCompression(bool enable)
+    {
+        compress = enable;
+    }
+
+    //also publish written packets through a shared memory ring of the given
+    //size. Readers on the same host choose it at connect time by connecting
+    //to <port name>/shm instead of the port itself. Call after open().
+    //Limits: the events are still copied twice, into the ring by the writer
+    //and out of it into a reader packet (or ringWindow) by each reader, and
+    //every packet still sends a small reference message over the yarp
+    //connection to wake the reader. The saving is the socket copy of the
+    //events, so it pays off for large packets; the cost for small ones is
+    //as for a local tcp port
+    bool openSharedMemory(size_t bytes = 1 << 26)
+    {
+        std::string name = yarp::os::BufferedPort< ev::packet<T> >::getName();
+        shm.reset(new shmRing);
+        if(!shm->create(shmRing::segmentName(name), bytes)) {
+            shm.reset();
+            return false;
+        }
+        shm_port.reset(new yarp::os::BufferedPort< shmPacket<T> >);
+        shm_port->setStrict();
+        if(!shm_port->open(name + "/shm")) {
+            yError() << "Could not open port: " << name + "/shm";
+            shm_port.reset();
+            shm.reset();
+            return false;
+        }
+        return true;
+    }
+
+    bool open(const std::string &name)
+    {
+        if(!yarp::os::BufferedPort< ev::packet<T> >::open(name))
+            return false;
+        telemetry.open(name);
+        return true;
+    }
+
+    void close()
+    {
+        telemetry.close();
+        if(shm_port) shm_port->close();
+        yarp::os::BufferedPort< ev::packet<T> >::close();
+        arrived.notify();
+    }
+
+    //wake a blocked read, which returns nullptr (or an empty batch) until
+    //resume()
+    void interrupt()
+    {
+        interrupted = true;
+        yarp::os::BufferedPort< ev::packet<T> >::interrupt();
+        arrived.notify();
+    }
+
+    void resume()
+    {
+        interrupted = false;
+        yarp::os::BufferedPort< ev::packet<T> >::resume();
+    }
+
+    //packets received and not yet read
+    int getPendingReads()
+    {
+        return (int)_pending();
+    }
+
     bool unprepare()
     {
         prepared = nullptr;
+        pending = false;
+        pending_duration = 0.0;
+        subsampled = 0;
         return yarp::os::BufferedPort< ev::packet<T> >::unprepare();
     }
 
     ev::packet<T>* read(bool shouldWait = true) 
     {
-        ev::packet<T>* result = yarp::os::BufferedPort<ev::packet<T> >::read(shouldWait);
-        if(result) yarp::os::BufferedPort< ev::packet<T> >::getEnvelope(result->envelope());
-        return result;
+        _releaseBatch();
+        telemetry.readStart();
+        ev::packet<T>* p = _read(shouldWait ? -1.0 : 0.0);
+        telemetry.readEnd(_pending());
+        return p;
+    }
+
+    //read all pending packets (up to max_packets) in a single call. Waits up
+    //to timeout seconds for the first packet (negative waits indefinitely).
+    //An empty batch is returned on timeout or if the port is closed.
+    const packetBatch<T>& readBatch(unsigned int max_packets = 1000, double timeout = -1.0)
+    {
+        _releaseBatch();
+        telemetry.readStart();
+
+        //read packets are held so the port does not reuse them while we drain
+        ev::packet<T>* p = _read(timeout);
+        while(p) {
+            batch.packets.push_back(p);
+            batch.stats.count += p->size();
+            batch.stats.duration += p->duration();
+            batch.stats.timestamp = p->timestamp();
+            if(batch.packets.size() >= max_packets) break;
+            p = _read(0.0);
+        }
+
+        if(!batch.empty()) {
+            batch.first = batch.packets.front()->envelope();
+            batch.last = batch.packets.back()->envelope();
+        }
+        telemetry.readEnd(_pending());
+        return batch;
     }
 
-    using yarp::os::BufferedPort< ev::packet<T> >::open;
-    using yarp::os::BufferedPort< ev::packet<T> >::getPendingReads;
-    using yarp::os::BufferedPort< ev::packet<T> >::close;
-    using yarp::os::BufferedPort< ev::packet<T> >::interrupt;
-    using yarp::os::BufferedPort< ev::packet<T> >::resume;
     using yarp::os::BufferedPort< ev::packet<T> >::isWriting;
     using yarp::os::BufferedPort< ev::packet<T> >::isClosed;
 };
 
+/// \brief unbounded single-producer/single-consumer queue. Nodes released
+/// by the consumer are reused by the producer, so no memory is allocated once
+/// the queue has reached its working size and neither side takes a lock.
+template <typename V> class spscQueue
+{
+private:
+
+    struct node
+    {
+        std::atomic<node*> next{nullptr};
+        V value;
+    };
+
+    //consumer side
+    std::atomic<node*> tail;
+    char _pad[64];
+    //producer side (first up to tail are free nodes)
+    node* head;
+    node* first;
+    node* tail_copy;
+
+    node* allocate()
+    {
+        if(first == tail_copy)
+            tail_copy = tail.load(std::memory_order_acquire);
+        if(first != tail_copy) {
+            node *n = first;
+            first = first->next.load(std::memory_order_relaxed);
+            return n;
+        }
+        return new node;
+    }
+
+public:
+
+    spscQueue()
+    {
+        node *n = new node;
+        head = first = tail_copy = n;
+        tail.store(n, std::memory_order_relaxed);
+    }
+
+    ~spscQueue()
+    {
+        node *n = first;
+        while(n) {
+            node *next = n->next.load(std::memory_order_relaxed);
+            delete n;
+            n = next;
+        }
+    }
+
+    spscQueue(const spscQueue&) = delete;
+    spscQueue& operator=(const spscQueue&) = delete;
+
+    //producer thread only
+    void push(const V &value)
+    {
+        node *n = allocate();
+        n->next.store(nullptr, std::memory_order_relaxed);
+        n->value = value;
+        head->next.store(n, std::memory_order_release);
+        head = n;
+    }
+
+    //consumer thread only
+    bool pop(V &value)
+    {
+        node *t = tail.load(std::memory_order_relaxed);
+        node *n = t->next.load(std::memory_order_acquire);
+        if(!n) return false;
+        value = n->value;
+        tail.store(n, std::memory_order_release);
+        return true;
+    }
+};
+
+template <typename T> class offlineLoader;
+
 template <typename T> class window : public yarp::os::Thread
 {
 public:
@@ -316,9 +954,17 @@ public:
             _id = (*last)->id();
         }
 
-        void setAsStart(typename std::list< packet<T>* >::iterator first, typename std::list< packet<T>* >::iterator last)
+        //end part way through the last packet
+        void setAsEnd(typename std::list< packet<T>* >::iterator last, size_t offset)
         {
-            m_ptr = (**first).begin();
+            m_ptr = (**last).begin() + offset;
+            _timestamp = (*last)->timestamp();
+            _id = (*last)->id();
+        }
+
+        void setAsStart(typename std::list< packet<T>* >::iterator first, typename std::list< packet<T>* >::iterator last, size_t offset = 0)
+        {
+            m_ptr = (**first).begin() + offset;
             packet_it = first;
             final = last;
             _timestamp = (*first)->timestamp();
@@ -373,6 +1019,7 @@ public:
         friend bool operator!= (const iterator& a, const iterator& b) { return a.m_ptr != b.m_ptr; };
 
         private:
+        friend class window<T>;
         int _id{0};
         double _timestamp{0.0};
         typename packet<T>::iterator m_ptr;
@@ -383,6 +1030,24 @@ public:
     iterator begin() { return _begin; }
     iterator end()   { return _end; }
 
+    //copy the events of the current window into separate arrays, transposing
+    //each packet as one contiguous block (address event types only). Use
+    //ev::longEventArrays for events with 64 bit stamps (longAE)
+    template <typename S> void getArrays(basicEventArrays<S> &arrays)
+    {
+        arrays.clear();
+        if(_begin == _end) return;
+        auto i = first_packet;
+        auto from = _begin.m_ptr;
+        while(true) {
+            bool last = i == last_packet;
+            auto to = last ? _end.m_ptr : (**i).end();
+            if(to > from) arrays.append(&(*from), to - from);
+            if(last) break;
+            from = (**(++i)).begin();
+        }
+    }
+
     //methods to access the data
     //read packet is unique as it returns the packet while the other methods
     //set the iterators that allow iteration through the data agnostic to the 
@@ -390,10 +1055,13 @@ public:
     packet<T>* readPacket(bool blocking = true)
     {
         std::unique_lock<std::mutex> lk(m);
+        readScope scope(*this);
         _removeAlreadyRead();
 
         if(blocking)
-            signal.wait(lk, [this]{return in_port.count > 0;});
+            _wait([this]{_drain(); return in_port.count > 0;});
+        else
+            _poll();
 
         if(active.empty()) 
         {
@@ -404,7 +1072,7 @@ public:
         else
         {
             _resetIterators(active.begin(), std::next(active.begin()));
-            in_window = {(unsigned int)(**active.begin()).size(), 
+            in_window = {(unsigned int)(**active.begin()).size() - front_offset, 
                         (**active.begin()).duration(), 
                         (**active.begin()).timestamp()};
             return *active.begin();
@@ -415,13 +1083,16 @@ public:
     {
         //enter critical section
         std::unique_lock<std::mutex> lk(m);
+        readScope scope(*this);
 
         //remove all the old data
         _removeAlreadyRead();
 
         //if blocking wait for some data
         if(blocking)
-            signal.wait(lk, [this]{return in_port.count > 0 || isStopping();});
+            _wait([this]{_drain(); return in_port.count > 0 || isStopping();});
+        else
+            _poll();
 
         //set the new window for all data
         _resetIterators(active.begin(), active.end());
@@ -434,29 +1105,44 @@ public:
     info readSlidingWinT(double seconds, bool blocking = true)
     {
         std::unique_lock<std::mutex> lk(m);
+        readScope scope(*this);
 
         if(blocking) 
-            signal.wait(lk, [this]{return in_port.count > in_window.count || isStopping();});
-        
+            _wait([this]{_drain(); return in_port.count > in_window.count + trimmed || isStopping();});
+        else
+            _poll();
+
+#if ENABLE_TS
+        //pop packets that only hold events older than the window
+        unsigned int ticks = clock.secondsToTicks(seconds);
+        T *newest = _newest();
+        while(newest && active.size() > 1)
+        {
+            packet<T> &front = **active.begin();
+            if(front.size() && clock.deltaTicks((stamp)newest->ts, (stamp)front[front.size()-1].ts) <= ticks)
+                break;
+            _popFront();
+        }
+#else
          //pop packets until we find the desired temporal window
         while(!active.empty())
         {
             //get the first packet in the active queue stats
             auto packet_duration = (**active.begin()).duration();
-            auto packet_count =  (**active.begin()).size();
 
             //if we can remove the packet and stay in the correct time do it
             if(in_port.duration - packet_duration < seconds)
                 break;
-            in_port.duration -= packet_duration;
-            in_port.count -= packet_count;
-            inactive.push_back(*active.begin());
-            active.pop_front();
+            _popFront();
         }
+#endif
 
         //set the correct iterators
         _resetIterators(active.begin(), active.end());
         in_window = in_port;
+#if ENABLE_TS
+        _trimFront(seconds);
+#endif
 
         return in_window;
     }
@@ -465,26 +1151,28 @@ public:
     {
         //ensure that time has passed in this port
         std::unique_lock<std::mutex> lk(m);
-        signal.wait(lk, [this, &exact_time]{return (in_port.count && in_port.timestamp >= exact_time) || isStopping();});
+        readScope scope(*this);
+        _wait([this, &exact_time]{_drain(); return (in_port.count && in_port.timestamp >= exact_time) || isStopping();});
 
          //pop packets until we find the desired temporal window less than the exact time
         while(!active.empty())
         {
             //get the first packet in the active queue stats
-            auto packet_duration = (**active.begin()).duration();
-            auto packet_count =  (**active.begin()).size();
             auto packet_timestamp = (**active.begin()).timestamp();
 
             //if we can remove the packet and stay in the correct time do it
             if(packet_timestamp + seconds >= exact_time)
                 break;
-            in_port.duration -= packet_duration;
-            in_port.count -= packet_count;
-            inactive.push_back(*active.begin());
-            active.pop_front();
+            _popFront();
         }
 
+        //stopped, or the replayed log finished before exact_time
         in_window = {0, 0.0, 0.0};
+        if(active.empty()) {
+            _resetIterators(active.begin(), active.begin());
+            return in_window;
+        }
+
         auto i = active.begin();
         do {
             in_window.duration += (**i).duration();
@@ -492,9 +1180,13 @@ public:
             in_window.timestamp = (**i).timestamp();
             i++;
         } while(i != active.end() && (**i).timestamp() < exact_time);
+        in_window.count -= front_offset;
 
         //set the correct iterators
         _resetIterators(active.begin(), i);
+#if ENABLE_TS
+        _trimFront(seconds);
+#endif
 
         return in_window;
     }
@@ -502,23 +1194,22 @@ public:
     info readSlidingWinN(unsigned int count, bool blocking = true)
     {
         std::unique_lock<std::mutex> lk(m);
+        readScope scope(*this);
         if(blocking) 
-            signal.wait(lk, [this]{return  in_port.count > in_window.count || isStopping();});
+            _wait([this]{_drain(); return  in_port.count > in_window.count + trimmed || isStopping();});
+        else
+            _poll();
 
          //pop packets until we find the desired fixed-count window
         while(!active.empty())
         {
             //get the first packet in the active queue stats
-            auto packet_duration = (**active.begin()).duration();
-            auto packet_count =  (**active.begin()).size();
+            auto packet_count =  (**active.begin()).size() - front_offset;
 
             //if we can remove the packet and stay in the correct time do it
             if(in_port.count - packet_count < count)
                 break;
-            in_port.duration -= packet_duration;
-            in_port.count -= packet_count;
-            inactive.push_back(*active.begin());
-            active.pop_front();
+            _popFront();
         }
 
         //set the correct iterators
@@ -532,14 +1223,15 @@ public:
     {
         //first of all remove all the old stuff
         std::unique_lock<std::mutex> lk(m);
+        readScope scope(*this);
         _removeAlreadyRead();
 
         //if we are blocking on a condition then wait till we have enough data
         if(blocking) {
-            while(in_port.count < count) {
-                signal.wait(lk);
-                if(isStopping()) return {0, 0, 0};
-            }
+            _wait([this, count]{_drain(); return in_port.count >= count || isStopping();});
+            if(in_port.count < count) return {0, 0, 0};
+        } else {
+            _poll();
         }
 
         //move the iterator until we find our condition, or no more data
@@ -551,9 +1243,10 @@ public:
             in_window.timestamp = (**last_packet).timestamp();
             last_packet++;
 
-            if(in_window.count >= count)
+            if(in_window.count - front_offset >= count)
                 break;
         }
+        in_window.count -= front_offset;
 
         //set the new window for all data
         _resetIterators(active.begin(), last_packet);
@@ -565,14 +1258,26 @@ public:
     {
         //first of all remove all the old stuff
         std::unique_lock<std::mutex> lk(m);
+        readScope scope(*this);
         _removeAlreadyRead();
 
         //if we are blocking on a condition then wait till we have enough data
+#if ENABLE_TS
+        //use the event timestamps to wait for, and cut, exactly seconds of data
+        unsigned int ticks = clock.secondsToTicks(seconds);
         if(blocking) {
-            while(in_port.duration < seconds) {
-                signal.wait(lk);
-                if(isStopping()) return {0, 0, 0};
-            }
+            _wait([this, ticks]{_drain(); return _spanTicks() >= ticks || isStopping();});
+            if(_spanTicks() < ticks) return {0, 0, 0};
+        } else {
+            _poll();
+        }
+        return _chunkTicks(ticks);
+#else
+        if(blocking) {
+            _wait([this, seconds]{_drain(); return in_port.duration >= seconds || isStopping();});
+            if(in_port.duration < seconds) return {0, 0, 0};
+        } else {
+            _poll();
         }
 
         //move the iterator until we find our condition, or no more data
@@ -587,11 +1292,13 @@ public:
             if(in_window.duration >= seconds)
                 break;
         }
+        in_window.count -= front_offset;
 
         //set the new window for all data
         _resetIterators(active.begin(), last_packet);
 
         return in_window;
+#endif
     }
 
     window()
@@ -606,8 +1313,9 @@ public:
         port.close();
         for(auto i = active.begin(); i != active.end(); i++)
             delete *i;
-        for(auto i = inactive.begin(); i != inactive.end(); i++)
-            delete *i;
+        packet<T>* p = nullptr;
+        while(incoming.pop(p)) delete p;
+        while(recycled.pop(p)) delete p;
     }
 
     info stats_current(void) const
@@ -633,191 +1341,1726 @@ public:
             yError() << "Could not open port: " << name;
             return false;
         }
+        telemetry.open(name);
         return this->start();
     }
 
-    void interrupt()
+    //also notify another signal when a packet arrives (e.g. a reader of
+    //several windows). Call before open()
+    void setListener(eventSignal *listener)
     {
-        port.interrupt();
+        this->listener = listener;
     }
 
-    void resume()
+    //use the clock of the sensor on this port for the event timestamps
+    //instead of the process clock (see ev::setClock), e.g. to read an 80 ns
+    //and a 1 us camera in one process. Call before reading
+    void setClock(unsigned int period_ns, unsigned int timer_bits)
     {
-        port.resume();
+        clock = sensorClock(period_ns, timer_bits);
     }
 
-    void onStop()
+    //e.g. setClock(ev::usbClock())
+    void setClock(const sensorClock &sensor)
     {
-        port.close();
-        //m.unlock();
+        clock = sensor;
     }
 
-    void run()
+    //read the packets of a log (see ev::offlineLoader) instead of a port.
+    //No yarp network is needed. With speed = 0 the next packet is delivered
+    //each time a read waits for data, so the windows only depend on the log
+    //and the reads. speed > 0 delivers the packets at their recorded times
+    //(scaled by speed) as a live port would.
+    bool openReplay(const std::string &path, double speed = 0.0)
     {
-        while(true) {
+        replay.reset(new offlineLoader<T>);
+        if(!replay->load(path)) {
+            yError() << "Could not load log: " << path;
+            replay.reset();
+            return false;
+        }
+        replay_speed = speed;
+        replay_next = 0;
+        replay_tic = 0.0;
+        telemetry.open(path);
+        return true;
+    }
+
+    //all the packets of the replayed log have been delivered
+    bool replayFinished() const
+    {
+        return replay && replay_next >= replay->getPacketCount();
+    }
+
+    void interrupt()
+    {
+        port.interrupt();
+    }
+
+    void resume()
+    {
+        port.resume();
+    }
+
+    void onStop()
+    {
+        port.close();
+        //m.unlock();
+    }
+
+    void run()
+    {
+        packet<T>* current_packet = nullptr;
+        while(true) {
+
+            //reuse a packet released by the reader or create more
+            if(!current_packet && !recycled.pop(current_packet))
+                current_packet = new packet<T>;
+
+            //blocking read from the port
+            bool read_success = port.read(*current_packet);
+
+            //and handle return without data
+            if(isStopping()) {
+                delete current_packet;
+                break;
+            }
+            else if(!read_success) {
+                yWarning() << "port read failure!";
+                delete current_packet;
+                break;
+            }
+
+            //nothing to publish (e.g. shared memory data was overwritten)
+            if(!current_packet->size())
+                continue;
+
+            port.getEnvelope(current_packet->envelope());
+            telemetry.record(current_packet->size(), current_packet->timestamp());
+
+            //publish to the reader without locking, the reader updates the
+            //active list and in_port info when it next reads
+            incoming.push(current_packet);
+            current_packet = nullptr;
+            signal.notify();
+            if(listener) listener->notify();
+        }
+        signal.notify();
+        if(listener) listener->notify();
+
+    }
+
+    std::string getName()
+    {
+        return port.getName();
+    }
+
+    int getInputCount()
+    {
+        return port.getInputCount();
+    }
+
+
+private:
+
+    //counts the time the reader spent since its last read when a read
+    //starts, and the data left unprocessed when it returns (under the lock)
+    struct readScope
+    {
+        window<T> &w;
+        readScope(window<T> &w) : w(w) { w.telemetry.readStart(); }
+        ~readScope() { w.telemetry.readEnd(w.stats_unprocessed().count); }
+    };
+
+    void _removeAlreadyRead(void)
+    {
+        if(last_packet == active.end()) return;
+
+        //a window that ended part way through its last packet keeps the
+        //packet, with the events already read skipped by front_offset
+        auto stop = back_offset ? last_packet : std::next(last_packet);
+        while(active.begin() != stop)
+            _popFront();
+        if(back_offset) {
+            in_port.count -= back_offset - front_offset;
+            front_offset = back_offset;
+            back_offset = 0;
+        }
+        first_packet = last_packet = active.end();
+    }
+
+    //release the oldest packet, removing what remains of it from in_port
+    void _popFront(void)
+    {
+        in_port.duration -= (**active.begin()).duration();
+        in_port.count -= (**active.begin()).size() - front_offset;
+        front_offset = 0;
+        _release(active.begin());
+    }
+
+#if ENABLE_TS
+    //an event timestamp after promotion: int for wrapping timestamps and
+    //uint64_t for unwrapped ones, selecting the matching deltaTicks
+    typedef decltype(+std::declval<T>().ts) stamp;
+
+    //the first unread event and the last event (nullptr if none)
+    T* _oldest(void)
+    {
+        for(auto i = active.begin(); i != active.end(); i++) {
+            size_t offset = i == active.begin() ? front_offset : 0;
+            if((**i).size() > offset) return &(**i)[offset];
+        }
+        return nullptr;
+    }
+
+    T* _newest(void)
+    {
+        for(auto i = active.rbegin(); i != active.rend(); i++)
+            if((**i).size()) return &(**i)[(**i).size()-1];
+        return nullptr;
+    }
+
+    //ticks between the oldest unread event and the newest event
+    unsigned int _spanTicks(void)
+    {
+        T *oldest = _oldest();
+        if(!oldest) return 0;
+        return clock.deltaTicks((stamp)_newest()->ts, (stamp)oldest->ts);
+    }
+
+    //move the start of the window to the first event within seconds of the
+    //last event in the window, searching only inside the boundary packet
+    void _trimFront(double seconds)
+    {
+        if(last_packet == active.end()) return;
+        auto last = last_packet;
+        while(last != first_packet && !(**last).size()) last--;
+        if(!(**last).size()) return;
+        stamp newest = (**last)[(**last).size()-1].ts;
+        unsigned int ticks = clock.secondsToTicks(seconds);
+
+        //whole packets older than the window
+        size_t offset = first_packet == active.begin() ? front_offset : 0;
+        while(first_packet != last_packet && ((**first_packet).size() <= offset ||
+              clock.deltaTicks(newest, (**first_packet)[(**first_packet).size()-1].ts) > ticks)) {
+            trimmed += (**first_packet).size() - offset;
+            first_packet++;
+            offset = 0;
+        }
+
+        //events older than the window in the boundary packet
+        auto first = (**first_packet).begin() + offset;
+        auto cut = std::partition_point(first, (**first_packet).end(),
+            [this, newest, ticks](const T &v){return clock.deltaTicks(newest, v.ts) > ticks;});
+        trimmed += cut - first;
+
+        in_window.count -= trimmed;
+        in_window.duration = clock.ticksToSeconds(clock.deltaTicks(newest, cut->ts));
+        _begin.setAsStart(first_packet, last_packet, cut - (**first_packet).begin());
+    }
+
+    //set a window from the oldest unread event to the last event less than
+    //ticks after it. Events after the cut are left for the next read
+    info _chunkTicks(unsigned int ticks)
+    {
+        in_window = {0, 0, 0};
+        if(!_oldest()) {
+            _resetIterators(active.begin(), active.begin());
+            return in_window;
+        }
+        stamp oldest = _oldest()->ts;
+        stamp newest = oldest;
+
+        size_t end_offset = 0;
+        auto i = active.begin();
+        for(; i != active.end(); i++) {
+            packet<T> &p = **i;
+            size_t offset = i == active.begin() ? front_offset : 0;
+            if(p.size() <= offset) continue;
+
+            in_window.timestamp = p.timestamp();
+            if(clock.deltaTicks(p[p.size()-1].ts, oldest) < ticks) {
+                in_window.count += p.size() - offset;
+                newest = p[p.size()-1].ts;
+                continue;
+            }
+
+            //the cut is in this packet
+            auto first = p.begin() + offset;
+            auto cut = std::partition_point(first, p.end(),
+                [this, oldest, ticks](const T &v){return clock.deltaTicks(v.ts, oldest) < ticks;});
+            in_window.count += cut - first;
+            if(cut != first) newest = (cut-1)->ts;
+            end_offset = cut - p.begin();
+            break;
+        }
+
+        if(i == active.end()) {
+            _resetIterators(active.begin(), active.end());
+        } else if(end_offset == 0) {
+            _resetIterators(active.begin(), i);
+        } else {
+            _resetIterators(active.begin(), std::next(i), 0, end_offset);
+        }
+        in_window.duration = clock.ticksToSeconds(clock.deltaTicks(newest, oldest));
+        return in_window;
+    }
+#endif
+
+    //wait until the condition is true. When replaying a log the reader feeds
+    //the packets itself until the condition is true or the log is finished
+    template <typename C> void _wait(C condition)
+    {
+        if(!replay) {
+            signal.wait(condition);
+            return;
+        }
+        while(!condition() && _replayNext(true));
+    }
+
+    //take the data available without waiting
+    void _poll(void)
+    {
+        if(replay) _replayNext(false);
+        _drain();
+    }
+
+    //publish the next packet of the log (or all the packets due by now when
+    //replaying at a rate). Returns false once the log is finished
+    bool _replayNext(bool blocking)
+    {
+        const auto *table = replay->getPacketTable();
+        const T *events = replay->getEvents();
+        size_t n = replay->getPacketCount();
+        if(replay_next >= n) return false;
+
+        size_t last = replay_next + 1;
+        if(replay_speed > 0.0) {
+            double now = yarp::os::Time::now();
+            if(replay_tic == 0.0) replay_tic = now;
+            auto due = [this, table](size_t i) {
+                return replay_tic + (table[i].timestamp - table[0].timestamp) / replay_speed;
+            };
+            if(due(replay_next) > now) {
+                if(!blocking) return true;
+                yarp::os::Time::delay(due(replay_next) - now);
+                now = std::max(yarp::os::Time::now(), due(replay_next));
+            }
+            while(last < n && due(last) <= now) last++;
+        }
+
+        for(; replay_next < last; replay_next++) {
+            const auto &r = table[replay_next];
+            if(!r.count) continue;
+            packet<T>* p = nullptr;
+            if(!recycled.pop(p)) p = new packet<T>;
+            p->fillFromMemory((const char *)(events + r.offset), r.count * sizeof(T));
+            p->duration(r.duration);
+            p->envelope() = yarp::os::Stamp(r.id, r.timestamp);
+            telemetry.record(p->size());
+            incoming.push(p);
+        }
+        return true;
+    }
+
+    //move newly published packets to the active list (reader side only)
+    void _drain(void)
+    {
+        packet<T>* p = nullptr;
+        while(incoming.pop(p)) {
+            if(spare.empty()) {
+                active.push_back(p);
+            } else {
+                active.splice(active.end(), spare, spare.begin());
+                active.back() = p;
+            }
+            in_port.duration += p->duration();
+            in_port.count += p->size();
+            in_port.timestamp = p->timestamp();
+        }
+    }
+
+    //hand a packet back to the port thread, keeping the list node for reuse
+    void _release(typename std::list< packet<T>* >::iterator i)
+    {
+        recycled.push(*i);
+        spare.splice(spare.end(), active, i);
+    }
+
+    void _resetIterators(typename std::list< packet<T>* >::iterator start, typename  std::list< packet<T>* >::iterator end, size_t start_offset = 0, size_t end_offset = 0)
+    {
+        trimmed = 0;
+        back_offset = 0;
+        if(active.empty() || start == end) {
+            first_packet = active.end();
+            last_packet = active.end();
+            _begin = iterator();
+            _end = iterator();
+        } else {
+            first_packet = start;
+            last_packet = std::prev(end); //we need to drop it back one so it is inclusive in the data
+            if(start == active.begin() && start_offset < front_offset)
+                start_offset = front_offset;
+            _begin.setAsStart(first_packet, last_packet, start_offset);
+            if(end_offset && end_offset < (**last_packet).size()) {
+                back_offset = end_offset;
+                _end.setAsEnd(last_packet, end_offset);
+            } else {
+                _end.setAsEnd(last_packet);
+            }
+        }
+    }
+
+    //input port
+    yarp::os::Port port;
+
+    //data storage (active and spare list nodes are only touched by readers)
+    std::list< packet<T>* > active;
+    std::list< packet<T>* > spare;
+    spscQueue< packet<T>* > incoming;
+    spscQueue< packet<T>* > recycled;
+
+    //in_port is all data that has been read
+    info in_port{0};
+    //in_window is data that is actively asked to be interated through
+    info in_window{0};
+    //events of the front packet already read, events of the last packet
+    //in the window (0 for all) and events of the window packets trimmed
+    //from the start of the window
+    unsigned int front_offset{0};
+    unsigned int back_offset{0};
+    unsigned int trimmed{0};
+
+    //packet iterators point to packets be "in_window"
+    typename std::list< packet<T>* >::iterator last_packet;
+    typename std::list< packet<T>* >::iterator first_packet;
+    //iterators point to individual events "in_window"
+    iterator _begin;
+    iterator _end;
+
+    //thread synchronisation. m only serialises readers, the port thread
+    //never takes it
+    std::mutex m;
+    eventSignal signal;
+    eventSignal *listener{nullptr};
+
+    //clock of the event timestamps (the process clock by default)
+    sensorClock clock;
+
+    //log replayed instead of the port (the reader is also the producer)
+    std::unique_ptr< offlineLoader<T> > replay;
+    double replay_speed{0.0};
+    double replay_tic{0.0};
+    size_t replay_next{0};
+
+    portTelemetry telemetry;
+
+};
+
+/// \brief reads several ports (e.g. left and right cameras, IMU) as a single
+/// time ordered stream. Each input is an ev::window drained in batches, and
+/// the inputs are k-way merged with a heap so each event costs O(log N). With
+/// ENABLE_TS events are ordered by their (per input unwrapped) timestamp,
+/// otherwise by the timestamp of their packet.
+template <typename T> class mergedWindow
+{
+private:
+
+    struct input
+    {
+        window<T> port;
+        pooledBuffer<T> events;  //received but not yet merged
+        std::vector<double> keys;
+        size_t head{0};
+        double newest{0.0};
+        double arrival{0.0}; //when data was last received
+        bool started{false};
+        sensorClock clock;
+        vtsHelper unwrapper;
+    };
+
+    std::vector< std::unique_ptr<input> > inputs;
+    std::atomic<bool> stopping{false};
+    eventSignal signal;
+    double stale_timeout{1.0};
+
+    //the merged window
+    pooledBuffer<T> merged;
+    std::vector<unsigned int> sources;
+    std::vector<double> stamps;
+    info in_window{0};
+
+    //event timestamps in seconds, unwrapping those that wrap
+    static double _seconds(input &in, int ts) { return in.clock.ticksToSeconds(in.unwrapper(ts)); }
+    static double _seconds(input &in, uint64_t ts) { return in.clock.ticksToSeconds(ts); }
+
+    //move the new data of every input to its buffer
+    bool _refill()
+    {
+        bool received = false;
+        double now = yarp::os::Time::now();
+        for(auto &in : inputs) {
+            //merged events are only removed once they are half the buffer
+            if(in->head && 2 * in->head >= in->events.size()) {
+                in->events.erase(in->events.begin(), in->events.begin() + in->head);
+                in->keys.erase(in->keys.begin(), in->keys.begin() + in->head);
+                in->head = 0;
+            }
+            in_window.timestamp = std::max(in_window.timestamp, in->port.readAll(false).timestamp);
+            if(in->port.begin() == in->port.end())
+                continue;
+            for(auto i = in->port.begin(); i != in->port.end(); i++) {
+                in->events.push_back(*i);
+#if ENABLE_TS
+                in->keys.push_back(_seconds(*in, +i->ts));
+#else
+                in->keys.push_back(i.timestamp());
+#endif
+            }
+            in->newest = in->keys.back();
+            in->arrival = now;
+            in->started = true;
+            received = true;
+        }
+        return received;
+    }
+
+    //merge all buffered events up to (and including) the time limit
+    void _merge(double limit)
+    {
+        merged.clear();
+        sources.clear();
+        stamps.clear();
+
+        //min-heap of the next event of each input
+        typedef std::pair<double, unsigned int> next;
+        std::vector<next> heap;
+        auto later = [](const next &a, const next &b) { return a.first > b.first; };
+        for(unsigned int i = 0; i < inputs.size(); i++) {
+            input &in = *inputs[i];
+            if(in.head < in.keys.size() && in.keys[in.head] <= limit)
+                heap.push_back({in.keys[in.head], i});
+        }
+        std::make_heap(heap.begin(), heap.end(), later);
+
+        while(!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), later);
+            unsigned int i = heap.back().second;
+            input &in = *inputs[i];
+            merged.push_back(in.events[in.head]);
+            sources.push_back(i);
+            stamps.push_back(in.keys[in.head]);
+            in.head++;
+            if(in.head < in.keys.size() && in.keys[in.head] <= limit) {
+                heap.back().first = in.keys[in.head];
+                std::push_heap(heap.begin(), heap.end(), later);
+            } else {
+                heap.pop_back();
+            }
+        }
+
+        in_window.count = merged.size();
+        in_window.duration = merged.empty() ? 0.0 : stamps.back() - stamps.front();
+    }
+
+    //the time all started inputs have reached, ignoring inputs that have
+    //not received data for stale_timeout seconds
+    double _synchronised()
+    {
+        double limit = DBL_MAX;
+        double now = yarp::os::Time::now();
+        for(auto &in : inputs)
+            if(in->started && now - in->arrival < stale_timeout)
+                limit = std::min(limit, in->newest);
+        return limit;
+    }
+
+    //sleeps until an input receives data. A synchronised read also wakes
+    //when a stalled input can be ignored
+    info _read(bool blocking, bool synchronised)
+    {
+        _refill();
+        while(true) {
+            _merge(synchronised ? _synchronised() : DBL_MAX);
+            if(!blocking || merged.size() || stopping) break;
+            auto received = [this]{return _refill() || stopping;};
+            if(synchronised) signal.waitFor(stale_timeout, received);
+            else signal.wait(received);
+        }
+        return in_window;
+    }
+
+public:
+
+    struct iterator
+    {
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type   = std::ptrdiff_t;
+        using value_type        = T;
+        using pointer           = T*;
+        using reference         = T&;
+
+        iterator(const mergedWindow<T> *w, size_t i) : w(w), i(i) {}
+
+        //the input (in order of opening) the event was read from
+        unsigned int source() const { return w->sources[i]; }
+        //the time used to order the event (seconds)
+        double timestamp() const { return w->stamps[i]; }
+
+        const T& operator*() const { return w->merged[i]; }
+        const T* operator->() const { return &w->merged[i]; }
+        iterator& operator++() { i++; return *this; }
+        iterator operator++(int) { iterator t = *this; i++; return t; }
+
+        friend bool operator== (const iterator& a, const iterator& b) { return a.i == b.i; };
+        friend bool operator!= (const iterator& a, const iterator& b) { return a.i != b.i; };
+
+        private:
+        const mergedWindow<T> *w;
+        size_t i;
+    };
+
+    iterator begin() const { return iterator(this, 0); }
+    iterator end() const   { return iterator(this, merged.size()); }
+
+    //open one input port per name, all using the process clock
+    bool open(const std::vector<std::string> &names)
+    {
+        for(auto &name : names)
+            if(!add(name))
+                return false;
+        return true;
+    }
+
+    //open an input port whose sensor has its own clock, so inputs with
+    //different clocks are ordered in seconds, e.g. add("/right:i", ev::usbClock())
+    bool add(const std::string &name, const sensorClock &clock = sensorClock())
+    {
+        inputs.emplace_back(new input);
+        input &in = *inputs.back();
+        in.clock = clock;
+        in.unwrapper = vtsHelper(clock);
+        in.port.setClock(clock);
+        in.port.setListener(&signal);
+        return in.port.open(name);
+    }
+
+    void stop()
+    {
+        stopping = true;
+        signal.notify();
+        for(auto &in : inputs)
+            in->port.stop();
+    }
+
+    size_t size() const { return inputs.size(); }
+
+    //readSynchronised() stops waiting for an input that has not received
+    //data for this many seconds (default 1.0), so the other inputs are not
+    //buffered without bound
+    void setStaleTimeout(double seconds)
+    {
+        stale_timeout = seconds;
+    }
+
+    info stats_current(void) const
+    {
+        return in_window;
+    }
+
+    //all data received on every input, in time order
+    info readAll(bool blocking = true)
+    {
+        return _read(blocking, false);
+    }
+
+    //data up to the time that every input has reached, so that later reads
+    //stay in order across inputs. Inputs that have never received data, or
+    //none for the stale timeout, are ignored. Events such an input sends
+    //later can be older than those already read
+    info readSynchronised(bool blocking = true)
+    {
+        return _read(blocking, true);
+    }
+};
+
+/// \brief bytes (a multiple of the page size) of memory mapped twice back
+/// to back, so a block running past the end continues at the start.
+/// nullptr if it cannot be allocated
+void* mirrorAllocate(size_t bytes);
+void mirrorFree(void *mirror, size_t bytes);
+
+/// \brief a window backend that stores the events of all packets in a single
+/// preallocated ring. The ring is mapped twice in consecutive virtual memory so
+/// any window of events is contiguous, and packet boundaries are kept in a
+/// side table. Iterating is a pointer walk and no memory is allocated after
+/// open(). The reading interface follows ev::window, except that:
+/// readPacket() gives the info of the packet (read through begin()/end()) as
+/// there are no packet objects; the time based reads use packet durations
+/// even with ENABLE_TS; getArrays, setListener, setClock and openReplay are
+/// not provided; stats_dropped() counts the packets lost. A window is limited
+/// to half the ring capacity; packets that do not fit in the ring are dropped.
+template <typename T> class ringWindow : public yarp::os::Thread
+{
+private:
+
+    typedef struct
+    {
+        uint64_t start;
+        unsigned int count;
+        double duration;
+        double timestamp;
+        int id;
+    } boundary;
+
+public:
+
+    struct iterator
+    {
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type   = std::ptrdiff_t;
+        using value_type        = T;
+        using pointer           = T*;
+        using reference         = T&;
+
+        double timestamp() { return _timestamp; }
+        double packetID() { return _id; }
+
+        T& operator*() const { return *m_ptr; }
+        T* operator->() { return m_ptr; }
+        iterator& operator++()
+        {
+            m_ptr++;
+            while(m_ptr == packet_end && p != p_final) {
+                const boundary &b = (*table)[++p % table->size()];
+                packet_end = m_ptr + b.count;
+                _timestamp = b.timestamp;
+                _id = b.id;
+            }
+            return *this;
+        }
+
+        iterator& operator++(int k)
+        {
+            return ++(*this);
+        }
+
+        friend bool operator== (const iterator& a, const iterator& b) { return a.m_ptr == b.m_ptr; };
+        friend bool operator!= (const iterator& a, const iterator& b) { return a.m_ptr != b.m_ptr; };
+        friend ringWindow;
+
+        private:
+        int _id{0};
+        double _timestamp{0.0};
+        T* m_ptr{nullptr};
+        T* packet_end{nullptr};
+        const std::vector<boundary> *table{nullptr};
+        uint64_t p{0};
+        uint64_t p_final{0};
+    };
+
+    ringWindow(size_t event_capacity = 1 << 22, size_t packet_capacity = 1 << 16)
+    {
+        //the ring must be a multiple of both the page and the event size
+        size_t block = sysconf(_SC_PAGESIZE) * sizeof(T);
+        ring_bytes = ((event_capacity * sizeof(T) + block - 1) / block) * block;
+        capacity = ring_bytes / sizeof(T);
+        table.resize(packet_capacity);
+        ring = (T *)mirrorAllocate(ring_bytes);
+        if(!ring)
+            yError() << "ev::ringWindow could not allocate" << ring_bytes << "bytes";
+    }
+
+    ~ringWindow()
+    {
+        stop();
+        port.close();
+        if(ring) mirrorFree(ring, ring_bytes);
+    }
+
+    iterator begin() { return _begin; }
+    iterator end()   { return _end; }
+
+    //the oldest unread packet, iterated with begin()/end()
+    info readPacket(bool blocking = true)
+    {
+        std::unique_lock<std::mutex> lk(m);
+        readScope scope(*this);
+        _removeAlreadyRead();
+
+        if(blocking)
+            _wait(lk, [this]{return in_port.count > 0 || isStopping();});
+
+        if(p_tail == p_head) {
+            _setWindow(p_tail, p_tail);
+            in_window = {0, 0, 0};
+            return in_window;
+        }
+        const boundary &b = _front();
+        in_window = {b.count, b.duration, b.timestamp};
+        _setWindow(p_tail, p_tail + 1);
+        return in_window;
+    }
+
+    info readAll(bool blocking = true)
+    {
+        std::unique_lock<std::mutex> lk(m);
+        readScope scope(*this);
+        _removeAlreadyRead();
+
+        if(blocking)
+            _wait(lk, [this]{return in_port.count > 0 || isStopping();});
+
+        _setWindow(p_tail, p_head);
+        in_window = in_port;
+        return in_window;
+    }
+
+    info readSlidingWinT(double seconds, bool blocking = true)
+    {
+        std::unique_lock<std::mutex> lk(m);
+        readScope scope(*this);
+
+        if(blocking)
+            _wait(lk, [this]{return in_port.count > in_window.count || isStopping();});
+
+        //pop packets until we find the desired temporal window
+        while(p_tail != p_head) {
+            const boundary &b = _front();
+            if(in_port.duration - b.duration < seconds && in_port.count <= capacity / 2)
+                break;
+            _popFront();
+        }
+
+        _setWindow(p_tail, p_head);
+        in_window = in_port;
+        return in_window;
+    }
+
+    info readSlidingWinT(double seconds, double exact_time)
+    {
+        std::unique_lock<std::mutex> lk(m);
+        readScope scope(*this);
+        _wait(lk, [this, &exact_time]{return (in_port.count && in_port.timestamp >= exact_time) || isStopping();});
+
+        //pop packets until we find the desired temporal window less than the exact time
+        while(p_tail != p_head) {
+            const boundary &b = _front();
+            if(b.timestamp + seconds >= exact_time && in_port.count <= capacity / 2)
+                break;
+            _popFront();
+        }
+
+        in_window = {0, 0.0, 0.0};
+        uint64_t i = p_tail;
+        while(i != p_head) {
+            const boundary &b = table[i % table.size()];
+            if(i != p_tail && b.timestamp >= exact_time) break;
+            in_window.duration += b.duration;
+            in_window.count += b.count;
+            in_window.timestamp = b.timestamp;
+            i++;
+        }
+
+        _setWindow(p_tail, i);
+        return in_window;
+    }
+
+    info readSlidingWinN(unsigned int count, bool blocking = true)
+    {
+        std::unique_lock<std::mutex> lk(m);
+        readScope scope(*this);
+        if(blocking)
+            _wait(lk, [this]{return in_port.count > in_window.count || isStopping();});
+
+        if(count > capacity / 2) count = capacity / 2;
+
+        //pop packets until we find the desired fixed-count window
+        while(p_tail != p_head) {
+            if(in_port.count - _front().count < count)
+                break;
+            _popFront();
+        }
+
+        _setWindow(p_tail, p_head);
+        in_window = in_port;
+        return in_window;
+    }
+
+    info readChunkN(unsigned int count, bool blocking = true)
+    {
+        std::unique_lock<std::mutex> lk(m);
+        readScope scope(*this);
+        _removeAlreadyRead();
+
+        if(count > capacity / 2) count = capacity / 2;
+
+        if(blocking) {
+            _wait(lk, [this, &count]{return in_port.count >= count || isStopping();});
+            if(isStopping()) return {0, 0, 0};
+        }
+
+        in_window = {0, 0, 0};
+        uint64_t i = p_tail;
+        while(i != p_head) {
+            const boundary &b = table[i++ % table.size()];
+            in_window.duration += b.duration;
+            in_window.count += b.count;
+            in_window.timestamp = b.timestamp;
+            if(in_window.count >= count)
+                break;
+        }
+
+        _setWindow(p_tail, i);
+        return in_window;
+    }
+
+    info readChunkT(float seconds, bool blocking = true)
+    {
+        std::unique_lock<std::mutex> lk(m);
+        readScope scope(*this);
+        _removeAlreadyRead();
+
+        if(blocking) {
+            _wait(lk, [this, &seconds]{return in_port.duration >= seconds || in_port.count >= capacity / 2 || isStopping();});
+            if(isStopping()) return {0, 0, 0};
+        }
+
+        in_window = {0, 0, 0};
+        uint64_t i = p_tail;
+        while(i != p_head) {
+            const boundary &b = table[i++ % table.size()];
+            in_window.duration += b.duration;
+            in_window.count += b.count;
+            in_window.timestamp = b.timestamp;
+            if(in_window.duration >= seconds || in_window.count >= capacity / 2)
+                break;
+        }
+
+        _setWindow(p_tail, i);
+        return in_window;
+    }
+
+    info stats_current(void) const
+    {
+        return in_window;
+    }
+
+    info stats_unprocessed(void) const
+    {
+        return {in_port.count - in_window.count,
+                in_port.duration - in_window.duration,
+                in_port.timestamp};
+    }
+
+    info stats_all(void) const
+    {
+        return in_port;
+    }
+
+    //number of packets that did not fit in the ring
+    unsigned int stats_dropped(void) const
+    {
+        return dropped;
+    }
+
+    bool open(const std::string name)
+    {
+        if(!ring) return false;
+        if(!port.open(name)) {
+            yError() << "Could not open port: " << name;
+            return false;
+        }
+        telemetry.open(name);
+        return this->start();
+    }
+
+    void interrupt()
+    {
+        port.interrupt();
+    }
+
+    void resume()
+    {
+        port.resume();
+    }
+
+    void onStop()
+    {
+        port.close();
+    }
+
+    void run()
+    {
+        while(true) {
+
+            //blocking read from the port directly into the ring
+            bool read_success = port.read(receiver);
+
+            if(isStopping()) {
+                break;
+            } else if(!read_success) {
+                yWarning() << "port read failure!";
+                break;
+            }
+            //an empty packet would become a window boundary no iterator
+            //can move past, so it is skipped as ev::window does
+            if(!receiver.accepted || !receiver.count) continue;
+
+            yarp::os::Stamp envelope;
+            port.getEnvelope(envelope);
+            telemetry.record(receiver.count, envelope.getTime());
+
+            {
+                std::lock_guard<std::mutex> lock(m);
+                table[p_head % table.size()] = {e_head, receiver.count, receiver.duration,
+                                                envelope.getTime(), envelope.getCount()};
+                p_head++;
+                e_head += receiver.count;
+                in_port.duration += receiver.duration;
+                in_port.count += receiver.count;
+                in_port.timestamp = envelope.getTime();
+            }
+            signal.notify();
+        }
+        signal.notify();
+    }
+
+    std::string getName()
+    {
+        return port.getName();
+    }
+
+    int getInputCount()
+    {
+        return port.getInputCount();
+    }
+
+private:
+
+    //sleep until the receiver publishes a packet that satisfies the
+    //condition. The condition is checked, and returns, with the lock held
+    template <typename C> void _wait(std::unique_lock<std::mutex> &lk, C condition)
+    {
+        lk.unlock();
+        signal.wait([&lk, &condition] {
+            lk.lock();
+            if(condition()) return true;
+            lk.unlock();
+            return false;
+        });
+    }
+
+    //reader time and unprocessed data for the telemetry (see ev::window)
+    struct readScope
+    {
+        ringWindow &w;
+        readScope(ringWindow &w) : w(w) { w.telemetry.readStart(); }
+        ~readScope() { w.telemetry.readEnd(w.stats_unprocessed().count); }
+    };
+
+    //parses the packet header and reads the events to the head of the ring
+    struct ringReceiver : public yarp::os::Portable
+    {
+        ringWindow *w;
+        unsigned int count{0};
+        double duration{0.0};
+        bool accepted{false};
+        std::vector<char> discard;
+        std::vector<uint8_t> wire;
+
+        explicit ringReceiver(ringWindow *w) : w(w) {}
+
+        bool read(yarp::os::ConnectionReader &reader) override
+        {
+            int n = 0;
+            payload format = payload::raw;
+            shmReference reference;
+            std::shared_ptr<const shmRing> ring;
+            accepted = false;
+            if(!packet<T>::readHeader(reader, duration, n, format)) return false;
+            size_t n_events = n / sizeof(T);
+            if(format == payload::compressed && !packet<T>::readCompressed(reader, n, wire, n_events)) return false;
+            if(format == payload::shared) {
+                if(!packet<T>::readReference(reader, reference)) return false;
+                ring = packet<T>::referencedRing(reference);
+                n_events = ring ? reference.count : 0;
+            }
+            count = n_events;
+
+            T* destination = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(w->m);
+                if(count <= w->capacity / 2 &&
+                   w->capacity - (w->e_head - w->e_tail) >= count &&
+                   w->p_head - w->p_tail < w->table.size())
+                    destination = w->ring + (w->e_head % w->capacity);
+            }
+
+            //the region beyond e_head is never accessed by the reader
+            if(destination) {
+                if(format == payload::shared) {
+                    accepted = ring && packet<T>::readShared(*ring, reference, destination);
+                    if(!accepted) w->dropped++;
+                    return true;
+                }
+                accepted = true;
+                if(format == payload::compressed)
+                    return decompressEvents(wire.data(), n, sizeof(T) / sizeof(uint32_t), (uint32_t *)destination, count);
+                return reader.expectBlock((char *)destination, n);
+            }
+
+            w->dropped++;
+            if(format != payload::raw) return true;
+            if(discard.size() < (size_t)n) discard.resize(n);
+            return reader.expectBlock(discard.data(), n);
+        }
+
+        bool write(yarp::os::ConnectionWriter &writer) const override
+        {
+            return false;
+        }
+    };
+
+    const boundary& _front()
+    {
+        return table[p_tail % table.size()];
+    }
+
+    void _popFront()
+    {
+        const boundary &b = _front();
+        in_port.duration -= b.duration;
+        in_port.count -= b.count;
+        e_tail += b.count;
+        p_tail++;
+    }
+
+    void _removeAlreadyRead()
+    {
+        while(p_tail != w_end && p_tail != p_head)
+            _popFront();
+    }
+
+    void _setWindow(uint64_t first, uint64_t end)
+    {
+        w_end = end;
+        if(first == end) {
+            _begin = iterator();
+            _end = iterator();
+            return;
+        }
+
+        const boundary &b = table[first % table.size()];
+        const boundary &l = table[(end - 1) % table.size()];
+        T* start = ring + (b.start % capacity);
+
+        _begin.table = &table;
+        _begin.m_ptr = start;
+        _begin.packet_end = start + b.count;
+        _begin.p = first;
+        _begin.p_final = end - 1;
+        _begin._timestamp = b.timestamp;
+        _begin._id = b.id;
+
+        _end = _begin;
+        _end.m_ptr = start + (l.start + l.count - b.start);
+        _end.p = end - 1;
+        _end._timestamp = l.timestamp;
+        _end._id = l.id;
+    }
+
+    //input port
+    yarp::os::Port port;
+    ringReceiver receiver{this};
+
+    //data storage. positions are monotonic counters
+    T* ring{nullptr};
+    size_t ring_bytes{0};
+    size_t capacity{0};
+    std::vector<boundary> table;
+    uint64_t e_head{0}, e_tail{0};
+    uint64_t p_head{0}, p_tail{0};
+    uint64_t w_end{0};
+    std::atomic<unsigned int> dropped{0};
+
+    info in_port{0};
+    info in_window{0};
+
+    //iterators point to individual events "in_window"
+    iterator _begin;
+    iterator _end;
+
+    //thread synchronisation
+    std::mutex m;
+    eventSignal signal;
+
+    portTelemetry telemetry;
+};
+
+/// \brief entry of the packet table of an offline dataset. In the binary log
+/// format the table is stored on disk exactly as this structure.
+typedef struct
+{
+    double timestamp;
+    double duration;
+    int32_t id;
+    uint32_t _fill;
+    uint64_t offset;
+    uint64_t count;
+} packetRecord;
+
+/// \brief header of the binary log format. It is followed by the packet table
+/// (n_packets * packetRecord) at index_offset and the raw events
+/// (n_events * event_size bytes) at data_offset.
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t event_size;
+    char tag[16];
+    uint64_t n_packets;
+    uint64_t n_events;
+    uint64_t index_offset;
+    uint64_t data_offset;
+} binaryHeader;
+
+static const char binary_magic[8] = {'E', 'V', '2', 'B', 'I', 'N', '\0', '\0'};
+static const uint32_t binary_version = 1;
+
+/// \brief a private writable mapping of a whole file (changes are never
+/// written back) for sequential reading. nullptr if it cannot be mapped
+void* mapFile(const std::string &path, size_t &bytes);
+void unmapFile(void *mapping, size_t bytes);
+
+template <typename T>
+class offlineLoader
+{
+public:
+struct iterator;
+
+private:
+    //text logs are parsed into owned storage, binary logs are mapped
+    pooledBuffer<T> owned_events;
+    std::vector<packetRecord> owned_index;
+    void *mapping{nullptr};
+    size_t mapping_size{0};
+
+    //contiguous view of the dataset used by the iterators
+    T *events{nullptr};
+    packetRecord *index{nullptr};
+    size_t n_packets{0};
+
+    iterator _begin;
+    iterator _end;
+    double time_sync_offset{0.0};
+    size_t event_count{0};
+
+    void unload()
+    {
+        if(mapping) unmapFile(mapping, mapping_size);
+        mapping = nullptr; mapping_size = 0;
+        //a parsed log can be most of the pool, return it to the system
+        bool owned = owned_events.capacity();
+        owned_events.clear(); owned_events.shrink_to_fit();
+        if(owned) packetPool::instance().trim();
+        owned_index.clear(); owned_index.shrink_to_fit();
+        events = nullptr; index = nullptr; cursor = nullptr;
+        n_packets = 0; event_count = 0;
+    }
+
+    //next packet to deliver when playing forward (or the last delivered
+    //packet when playing in reverse)
+    packetRecord *cursor{nullptr};
+
+    packetRecord* packets_end()
+    {
+        return index + n_packets;
+    }
+
+    //binary search the packet table for the first packet at or after timestamp
+    static packetRecord* _lowerBound(packetRecord *first, packetRecord *last, double timestamp)
+    {
+        return std::lower_bound(first, last, timestamp,
+            [](const packetRecord &r, double t) {return r.timestamp < t;});
+    }
+
+    bool loadText(std::string path, double seconds)
+    {
+        std::ifstream reader;
+        reader.open(path.c_str());
+        if(!reader.is_open())
+            return false;
+
+        std::string data_line;
+        while(getline(reader, data_line))
+        {
+            yarp::os::Bottle b(data_line);
+            const std::string &payload = b.get(4).asString();
+
+            packetRecord r;
+            r.id = b.get(0).asInt32();
+            r.timestamp = b.get(1).asFloat64();
+            r.duration = b.get(3).asInt32()*0.000001;
+            r._fill = 0;
+            r.offset = owned_events.size();
+            r.count = payload.size() / sizeof(T);
+            owned_events.resize(r.offset + r.count);
+            memcpy((char *)(owned_events.data() + r.offset), payload.data(), r.count * sizeof(T));
+            owned_index.push_back(r);
+
+            if(r.timestamp - owned_index.front().timestamp > seconds) break;
+        }
+
+        events = owned_events.data();
+        index = owned_index.data();
+        n_packets = owned_index.size();
+        event_count = owned_events.size();
+        return true;
+    }
+
+    //the mapping is writable so the user can modify events in place (e.g.
+    //flipping) without changing the file
+    bool loadBinary(double seconds)
+    {
+        if(mapping_size < sizeof(binaryHeader)) {
+            yError() << "Binary log is truncated";
+            unload();
+            return false;
+        }
+
+        //sizes are checked by division so a crafted header cannot overflow
+        const binaryHeader &h = *(binaryHeader *)mapping;
+        if(h.version != binary_version || h.event_size != sizeof(T)
+           || std::string(h.tag, strnlen(h.tag, sizeof(h.tag))) != T::tag
+           || h.index_offset > mapping_size || h.data_offset > mapping_size
+           || h.index_offset % alignof(packetRecord) || h.data_offset % alignof(T)
+           || h.n_packets > (mapping_size - h.index_offset) / sizeof(packetRecord)
+           || h.n_events > (mapping_size - h.data_offset) / sizeof(T)) {
+            yError() << "Binary log does not match the requested event type"
+                     << T::tag << "or is corrupted";
+            unload();
+            return false;
+        }
+
+        index = (packetRecord *)((char *)mapping + h.index_offset);
+        events = (T *)((char *)mapping + h.data_offset);
+        n_packets = h.n_packets;
+        event_count = h.n_events;
+
+        //the packets must tile the events in order, so no iterator can leave
+        //the mapping
+        uint64_t next = 0;
+        for(size_t i = 0; i < n_packets; i++) {
+            if(index[i].offset != next || index[i].count > event_count - next) {
+                yError() << "Binary log packet table is corrupted at packet" << i;
+                unload();
+                return false;
+            }
+            next += index[i].count;
+        }
+
+        //respect the maximum duration requested
+        if(n_packets && seconds < DBL_MAX) {
+            size_t i = 0;
+            while(i < n_packets && index[i].timestamp - index[0].timestamp <= seconds) i++;
+            n_packets = std::min(i + 1, (size_t)h.n_packets);
+            event_count = index[n_packets-1].offset + index[n_packets-1].count;
+        }
+        return true;
+    }
+
+    bool setIterators(packetRecord *same_packet)
+    {
+        if(n_packets == 0) return false;
+        bool ret = true;
+
+        //if same_packet is the end of data set both pointers to point to the final packet end
+        //else set them to the same packet start
+        if(same_packet == packets_end())
+        {
+            same_packet = std::prev(packets_end());
+            _begin.m_ptr = events + same_packet->offset + same_packet->count;
+            ret = false;
+        } else {
+            _begin.m_ptr = events + same_packet->offset;
+        }
+        _begin.base = events;
+        _begin.packet_it = same_packet;
+        _begin.final = same_packet;
+        _begin._id = same_packet->id;
+        _begin._timestamp = same_packet->timestamp;
+        _end = _begin;
+        return ret;
+    }
+
+    bool setIterators(packetRecord *first_packet, packetRecord *last_packet)
+    {
+        //if the first packet is finished the data invalidate the pointers.
+        if(first_packet == packets_end())
+        {
+            return setIterators(first_packet);
+        }
+
+        //if the last packet
+        if(last_packet == packets_end()) last_packet = std::prev(last_packet);
+
+        _begin.base = events;
+        _begin.packet_it = first_packet;
+        _begin.final = last_packet;
+        _begin._id = first_packet->id;
+        _begin._timestamp = first_packet->timestamp;
+        _begin.m_ptr = events + first_packet->offset;
+
+        _end.base = events;
+        _end.packet_it = last_packet;
+        _end.final = last_packet;
+        _end._id = last_packet->id;
+        _end._timestamp = last_packet->timestamp;
+        _end.m_ptr = events + last_packet->offset + last_packet->count;
+        return true;
+    }
+
+public:
+
+    //events of consecutive packets are contiguous in memory, therefore the
+    //iterator is a pointer walk and the packet is only tracked to provide the
+    //packet timestamp.
+    struct iterator
+    {
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type   = std::ptrdiff_t;
+        using value_type        = T;
+        using pointer           = T*;
+        using reference         = T&;
 
-            //find the best memory location to use or create more
-            bool reused_inactive = false;
-            packet<T>* current_packet = nullptr;
-            if(inactive.empty()) {
-                current_packet = new packet<T>;
-            } else {    
-                current_packet = inactive.front();
-                reused_inactive = true;
+        inline double timestamp() {return _timestamp;}
+        inline double packetID() {return _id;}
+
+        T& operator*() const { return *m_ptr; }
+        T* operator->() { return m_ptr; }
+        iterator& operator++()
+        {
+            m_ptr++;
+            while(packet_it != final && m_ptr == base + packet_it->offset + packet_it->count) {
+                ++packet_it;
+                _timestamp = packet_it->timestamp;
+                _id = packet_it->id;
             }
+            return *this;
+        }
 
-            //blocking read from the port
-            bool read_success = port.read(*current_packet);
+        iterator& operator++(int k)
+        {
+            return ++(*this);
+        }
 
-            //and handle return without data
-            if(isStopping()) {
-                break;
-            }
-            else if(!read_success) {
-                yWarning() << "port read failure!";
-                break;
-            }
+        friend bool operator== (const iterator& a, const iterator& b) { return a.m_ptr == b.m_ptr; };
+        friend bool operator!= (const iterator& a, const iterator& b) { return a.m_ptr != b.m_ptr; };
+        friend offlineLoader;
 
-            port.getEnvelope(current_packet->envelope());
+        private:
+            int _id{-1};
+            double _timestamp{0.0};
+            T* m_ptr{nullptr};
+            T* base{nullptr};
+            packetRecord* packet_it{nullptr};
+            packetRecord* final{nullptr};
+    };
 
-            //shared section - updated active, inactive, in_port info
-            {
-                std::lock_guard<std::mutex> lock(m); //releases leaving { }
-                if (reused_inactive) inactive.pop_front();
-                active.push_back(current_packet);
-                in_port.duration += current_packet->duration();
-                in_port.count += current_packet->size();
-                in_port.timestamp = current_packet->timestamp();
-            }
-            signal.notify_one();
-        }
-        signal.notify_one();
+    offlineLoader() = default;
+    offlineLoader(const offlineLoader&) = delete;
+    offlineLoader& operator=(const offlineLoader&) = delete;
 
+    ~offlineLoader()
+    {
+        unload();
     }
 
-    std::string getName()
+    //load a yarpdatadumper text log, or a binary log written with save(). The
+    //binary log is memory mapped and never parsed.
+    bool load(std::string path, double seconds = DBL_MAX)
     {
-        return port.getName();
+        if(seconds < 0.0) seconds = DBL_MAX;
+        unload();
+
+        //anything that is not a binary log is parsed as text
+        mapping = mapFile(path, mapping_size);
+        bool is_binary = mapping && mapping_size >= sizeof(binary_magic)
+                         && !memcmp(mapping, binary_magic, sizeof(binary_magic));
+        if(!is_binary) unload();
+
+        bool success = is_binary ? loadBinary(seconds) : loadText(path, seconds);
+        if(!success) return false;
+
+        if(!std::is_sorted(index, packets_end(),
+            [](const packetRecord &a, const packetRecord &b) {return a.timestamp < b.timestamp;}))
+            yWarning() << "Packet timestamps are not ordered: time seeking is unreliable";
+
+        //set both pointing to first event
+        cursor = index;
+        setIterators(index);
+        //time_sync_offset = -data.begin()->timestamp();
+
+        return true;
     }
 
-    int getInputCount()
+    //write the loaded data to the binary log format
+    bool save(std::string path)
     {
-        return port.getInputCount();
-    }
+        std::ofstream writer(path.c_str(), std::ios::binary | std::ios::trunc);
+        if(!writer.is_open())
+            return false;
 
+        binaryHeader h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, binary_magic, sizeof(binary_magic));
+        h.version = binary_version;
+        h.event_size = sizeof(T);
+        strncpy(h.tag, T::tag.c_str(), sizeof(h.tag) - 1);
+        h.n_packets = n_packets;
+        h.n_events = event_count;
+        h.index_offset = sizeof(binaryHeader);
+        //keep the events page aligned within the file
+        h.data_offset = h.index_offset + n_packets * sizeof(packetRecord);
+        h.data_offset += (4096 - h.data_offset % 4096) % 4096;
+
+        std::vector<char> padding(h.data_offset - h.index_offset - n_packets * sizeof(packetRecord), 0);
+        writer.write((const char *)&h, sizeof(h));
+        writer.write((const char *)index, n_packets * sizeof(packetRecord));
+        writer.write(padding.data(), padding.size());
+        writer.write((const char *)events, event_count * sizeof(T));
+        return writer.good();
+    }
 
-private:
+    void synchroniseRealtimeRead(double now)
+    {
+        time_sync_offset = now - index->timestamp;
+    }
 
-    void _removeAlreadyRead(void)
+    //forward playback: deliver the packets from the cursor until timestamp
+    bool incrementReadTill(double timestamp)
     {
-        if(last_packet != active.end()) ++last_packet;
-        while(first_packet != last_packet) {
-            in_port.duration -= (**first_packet).duration();
-            in_port.count -= (**first_packet).size();
-            inactive.push_back(*first_packet);
-            first_packet = active.erase(first_packet);
+        if(n_packets == 0) return false;
+        if(cursor == packets_end()) {
+            setIterators(cursor);
+            return false;
         }
+        timestamp -= time_sync_offset;
+
+        //find the first packet not yet under timestamp
+        packetRecord *next = _lowerBound(cursor + 1, packets_end(), timestamp);
+
+        //if the current packet is under timestamp, set the iterators to deliver this data
+        if(cursor->timestamp < timestamp) {
+            setIterators(cursor, std::prev(next));
+            cursor = next;
+        } else {
+            setIterators(cursor);
+        }
+
+        return true;
     }
 
-    void _resetIterators(typename std::list< packet<T>* >::iterator start, typename  std::list< packet<T>* >::iterator end)
+    //reverse playback: deliver the packets before the cursor back to timestamp
+    bool decrementReadTill(double timestamp)
     {
-        if(active.empty()) {
-            first_packet = active.begin();
-            last_packet = active.begin();
-            _begin = iterator();
-            _end = iterator();
+        if(n_packets == 0 || cursor == index) return false;
+        timestamp -= time_sync_offset;
+
+        packetRecord *first = _lowerBound(index, cursor, timestamp);
+        if(first == cursor) {
+            setIterators(cursor);
         } else {
-            first_packet = start;
-            last_packet = std::prev(end); //we need to drop it back one so it is inclusive in the data
-            _begin.setAsStart(first_packet, last_packet);
-            _end.setAsEnd(last_packet);
+            setIterators(first, std::prev(cursor));
+            cursor = first;
         }
+
+        return true;
     }
 
-    //input port
-    yarp::os::Port port;
+    //deliver the packets within duration before timestamp. Each call is
+    //independent of the previous one, so windows can be read in any order.
+    bool windowedReadTill(double timestamp, double duration)
+    {
+        if(n_packets == 0) return false;
+        timestamp -= time_sync_offset;
 
-    //data storage
-    std::list< packet<T>* > active;
-    std::list< packet<T>* > inactive;
+        packetRecord *first = std::partition_point(index, packets_end(),
+            [&](const packetRecord &r) {return timestamp - r.timestamp > duration;});
+        if(first == packets_end())
+            return false; //finish the dataset
 
-    //in_port is all data that has been read
-    info in_port{0};
-    //in_window is data that is actively asked to be interated through
-    info in_window{0};
+        //return atleast a single packet (never step before first, which
+        //may be the start of the table)
+        packetRecord *last = _lowerBound(first, packets_end(), timestamp);
+        if(last != first) --last;
 
-    //packet iterators point to packets be "in_window"
-    typename std::list< packet<T>* >::iterator last_packet;
-    typename std::list< packet<T>* >::iterator first_packet;
-    //iterators point to individual events "in_window"
-    iterator _begin;
-    iterator _end;
+        setIterators(first, last);
+        cursor = std::next(last);
 
-    //thread synchronisation
-    std::mutex m;
-    std::condition_variable signal;
+        return true;
+
+    }
+
+    //position the reading cursor at the first packet at or after timestamp
+    bool seek(double timestamp)
+    {
+        if(n_packets == 0) return false;
+        cursor = _lowerBound(index, packets_end(), timestamp - time_sync_offset);
+        return setIterators(cursor);
+    }
+
+    iterator begin() { return _begin; }
+    iterator end()   { return _end; }
+
+    //the packet table and the events of the loaded data
+    const packetRecord* getPacketTable() const { return index; }
+    const T* getEvents() const { return events; }
+    size_t getPacketCount() const { return n_packets; }
+
+    std::string getinfo() {
+        std::stringstream ss;
+        if(n_packets == 0)
+            return "no events loaded";
+        
+        ss << n_packets << " packets loaded with " << event_count << " total events"
+           << (mapping ? " (mapped). " : ". ")
+           << "Timestamps range from " << std::fixed << std::setprecision(3) << index->timestamp << " to " << std::prev(packets_end())->timestamp;
+        
+        return ss.str();
+    }
+
+    double getLength() 
+    {
+        if(n_packets)
+            return std::prev(packets_end())->timestamp - index->timestamp;
+        else
+            return 0.0;
+    }
+
+    double getStartTime()
+    {
+        if(n_packets)
+            return index->timestamp;
+        else
+            return 0.0;
+    }
 
 };
 
+/// \brief reads a yarpdatadumper text log with bounded memory. A background
+/// thread parses the log up to read_ahead seconds in front of the current
+/// read time, and packets are recycled as soon as they leave the read window.
+/// The reading interface matches offlineLoader.
 template <typename T>
-class offlineLoader
+class offlineStreamer
 {
 public:
 struct iterator;
 
 private:
-    std::list< ev::packet<T> > data;
-    iterator _begin;//{{nullptr, nullptr, -1, -1.0, nullptr}};
-    iterator _end;//{{nullptr, nullptr, -1, -1.0, nullptr}};
+    std::ifstream reader;
+    std::thread parser;
+
+    //data storage (as ev::window)
+    std::list< packet<T>* > active;
+    std::list< packet<T>* > inactive;
+    typename std::list< packet<T>* >::iterator first_packet;
+    typename std::list< packet<T>* >::iterator last_packet;
+    bool window_valid{false};
+
+    iterator _begin;
+    iterator _end;
+
+    //parsing state
+    double read_ahead{1.0};
+    double read_time{-DBL_MAX};
+    double max_time{DBL_MAX};
+    double start_time{0.0};
+    double latest_time{0.0};
     double time_sync_offset{0.0};
-    int event_count{0};
+    size_t event_count{0};
+    size_t packet_count{0};
+    bool finished{false};
+    bool stopping{false};
 
-    bool setIterators(typename std::list< packet<T> >::iterator same_packet)
+    //thread synchronisation
+    std::mutex m;
+    std::condition_variable parsed;
+    std::condition_variable consumed;
+
+    void parse()
     {
-        if(data.size() == 0) return false;
-        bool ret = true;
+        std::string data_line;
+        while(getline(reader, data_line))
+        {
+            yarp::os::Bottle b(data_line);
+
+            packet<T> *p = nullptr;
+            {
+                std::unique_lock<std::mutex> lk(m);
+                consumed.wait(lk, [this]{return stopping || active.empty() ||
+                              active.back()->timestamp() <= read_time + read_ahead;});
+                if(stopping) break;
+                if(inactive.empty()) {
+                    p = new packet<T>;
+                } else {
+                    p = inactive.front();
+                    inactive.pop_front();
+                }
+            }
+
+            //parse outside the critical section
+            p->envelope() = {b.get(0).asInt32(), b.get(1).asFloat64()};
+            p->duration(b.get(3).asInt32()*0.000001);
+            p->fillFromMemory(b.get(4).asString().data(), b.get(4).asString().size());
+
+            {
+                std::lock_guard<std::mutex> lk(m);
+                if(!packet_count) start_time = p->timestamp();
+                latest_time = p->timestamp();
+                event_count += p->size();
+                packet_count++;
+                active.push_back(p);
+            }
+            parsed.notify_all();
+
+            if(p->timestamp() - start_time > max_time) break;
+        }
 
-        //if same_packet is the end of data set both pointers to point to the final packet end
-        //else set them to the same packet start
-        if(same_packet == data.end()) 
         {
-            same_packet = std::prev(data.end());
-            _begin.m_ptr = same_packet->end();
-            ret = false;
-        } else {
-            _begin.m_ptr = same_packet->begin();
+            std::lock_guard<std::mutex> lk(m);
+            finished = true;
         }
-        _begin.packet_it = same_packet;
-        _begin.final = same_packet;
-        _begin._id = same_packet->id();
-        _begin._timestamp = same_packet->timestamp();
-        _end = _begin;
-        return ret;
+        parsed.notify_all();
     }
 
-    bool setIterators(typename std::list< packet<T> >::iterator first_packet, typename std::list< packet<T> >::iterator last_packet)
+    //move the packets before "until" to the inactive list for re-use
+    void _release(typename std::list< packet<T>* >::iterator until)
     {
-        //if the first packet is finished the data invalidate the pointers.
-        if(first_packet == data.end()) 
-        {
-            return setIterators(first_packet);
+        bool released = false;
+        while(active.begin() != until) {
+            inactive.push_back(active.front());
+            active.pop_front();
+            released = true;
         }
+        if(released) consumed.notify_one();
+    }
 
-        //if the last packet
-        if(last_packet == data.end()) last_packet = std::prev(last_packet);
-
-        _begin.packet_it = first_packet;
-        _begin.final = last_packet;
-        _begin._id = first_packet->id();
-        _begin._timestamp = first_packet->timestamp();
-        _begin.m_ptr = first_packet->begin();
+    void _resetIterators(typename std::list< packet<T>* >::iterator start, typename std::list< packet<T>* >::iterator last)
+    {
+        first_packet = start; last_packet = last;
+        window_valid = true;
+        _begin.setAsStart(first_packet, last_packet);
+        _end.setAsEnd(last_packet);
+    }
 
-        _end.packet_it = last_packet;
-        _end.final = last_packet;
-        _end._id = last_packet->id();
-        _end._timestamp = last_packet->timestamp();
-        _end.m_ptr = last_packet->end();
-        return true;
+    void _emptyIterators(typename std::list< packet<T>* >::iterator at)
+    {
+        window_valid = false;
+        _begin.setAsStart(at, at);
+        _end = _begin;
     }
 
 public:
@@ -830,6 +3073,22 @@ public:
         using pointer           = T*;
         using reference         = T&;
 
+        void setAsEnd(typename std::list< packet<T>* >::iterator last)
+        {
+            m_ptr = (**last).end();
+            _timestamp = (*last)->timestamp();
+            _id = (*last)->id();
+        }
+
+        void setAsStart(typename std::list< packet<T>* >::iterator first, typename std::list< packet<T>* >::iterator last)
+        {
+            m_ptr = (**first).begin();
+            packet_it = first;
+            final = last;
+            _timestamp = (*first)->timestamp();
+            _id = (*first)->id();
+        }
+
         inline double timestamp() {return _timestamp;}
         inline double packetID() {return _id;}
 
@@ -838,118 +3097,147 @@ public:
         iterator& operator++()
         {
             m_ptr++;
-            if(m_ptr == packet_it->end() && packet_it != final) {
-                m_ptr = (++packet_it)->begin();
-                _timestamp = packet_it->timestamp();
-                _id = packet_it->id();
+            while(m_ptr == (*packet_it)->end() && packet_it != final) {
+                m_ptr = (*(++packet_it))->begin();
+                _timestamp = (*packet_it)->timestamp();
+                _id = (*packet_it)->id();
             }
             return *this;
         }
 
         iterator& operator++(int k)
         {
-            m_ptr++;
-            if(m_ptr == packet_it->end() && packet_it != final) {
-                m_ptr = (++packet_it)->begin();
-                _timestamp = packet_it->timestamp();
-                _id = packet_it->id();
-            }
-            return *this;
+            return ++(*this);
         }
 
         friend bool operator== (const iterator& a, const iterator& b) { return a.m_ptr == b.m_ptr; };
         friend bool operator!= (const iterator& a, const iterator& b) { return a.m_ptr != b.m_ptr; };
-        friend offlineLoader;
 
         private:
             int _id{-1};
             double _timestamp{0.0};
-            typename packet<T>::iterator m_ptr{nullptr};
-            typename std::list< packet<T> >::iterator packet_it;
-            typename std::list< packet<T> >::iterator final;
+            typename packet<T>::iterator m_ptr;
+            typename std::list< packet<T>* >::iterator packet_it;
+            typename std::list< packet<T>* >::iterator final;
     };
 
-    bool load(std::string path, double seconds = DBL_MAX)
+    offlineStreamer() = default;
+    offlineStreamer(const offlineStreamer&) = delete;
+    offlineStreamer& operator=(const offlineStreamer&) = delete;
+
+    ~offlineStreamer()
     {
-        if(seconds < 0.0) seconds = DBL_MAX;
-        data.clear();
+        close();
+        for(auto i = active.begin(); i != active.end(); i++)
+            delete *i;
+        for(auto i = inactive.begin(); i != inactive.end(); i++)
+            delete *i;
+    }
+
+    //start parsing the log in the background keeping at most read_ahead
+    //seconds of data in front of the current read time.
+    bool load(std::string path, double seconds = DBL_MAX, double read_ahead = 1.0)
+    {
+        close();
+        inactive.splice(inactive.end(), active);
+        window_valid = false;
+        event_count = packet_count = 0;
 
-        std::ifstream reader;
         reader.open(path.c_str());
         if(!reader.is_open())
             return false;
 
-        std::string data_line;
-        while(getline(reader, data_line)) 
-        {
-            yarp::os::Bottle b(data_line);
-            
-            data.emplace_back(); ev::packet<T> &p = data.back();
-            p.envelope() = {b.get(0).asInt32(), b.get(1).asFloat64()};
-            p.duration(b.get(3).asInt32()*0.000001);
-            p.fillFromMemory(b.get(4).asString().data(), b.get(4).asString().size());
-            event_count += p.size();
-
-            if(p.timestamp() - data.begin()->timestamp() > seconds) break;
-        }
-
-        //set both pointing to first event
-        setIterators(data.begin());
-        //time_sync_offset = -data.begin()->timestamp();
+        if(seconds < 0.0) seconds = DBL_MAX;
+        max_time = seconds;
+        this->read_ahead = read_ahead;
+        stopping = finished = false;
+        parser = std::thread([this]{parse();});
 
+        //wait for the first packet so the start time is known
+        std::unique_lock<std::mutex> lk(m);
+        parsed.wait(lk, [this]{return finished || !active.empty();});
+        if(active.empty()) return false;
+        read_time = start_time;
+        _emptyIterators(active.begin());
         return true;
     }
 
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lk(m);
+            stopping = true;
+        }
+        consumed.notify_all();
+        if(parser.joinable()) parser.join();
+        if(reader.is_open()) reader.close();
+    }
+
     void synchroniseRealtimeRead(double now)
     {
-        time_sync_offset = now - data.begin()->timestamp();
+        time_sync_offset = now - start_time;
     }
 
     bool incrementReadTill(double timestamp)
     {
-        if(data.size() == 0) return false;
         timestamp -= time_sync_offset;
+        std::unique_lock<std::mutex> lk(m);
 
-        //firstly set both iterators to point to the next packet if needed
-        if(_end != _begin) {
-            std::advance(_end.packet_it, 1);
-            if(!setIterators(_end.packet_it))
-                return false;
+        //the previous window has been read and can be recycled
+        if(window_valid) _release(std::next(last_packet));
+        read_time = timestamp;
+        consumed.notify_one();
+
+        //wait until the data up to timestamp is parsed
+        parsed.wait(lk, [this, &timestamp]{return finished ||
+                    (!active.empty() && active.back()->timestamp() >= timestamp);});
+        if(active.empty()) {
+            window_valid = false;
+            return false;
         }
 
-        //if timestamp is greater than the next packet increment the _end packet
-        while(std::next(_end.packet_it) != data.end() && std::next(_end.packet_it)->timestamp() < timestamp)
-            std::advance(_end.packet_it, 1);
+        //if the next packet is not yet under timestamp deliver no data
+        if(active.front()->timestamp() >= timestamp) {
+            _emptyIterators(active.begin());
+            return true;
+        }
 
-        //if the current packet is under timestamp, set the iterators to deliver this data
-        if(_begin.packet_it->timestamp() < timestamp)
-            setIterators(_begin.packet_it, _end.packet_it);
+        auto last = active.begin();
+        while(std::next(last) != active.end() && (*std::next(last))->timestamp() < timestamp)
+            last++;
+        _resetIterators(active.begin(), last);
 
         return true;
     }
 
     bool windowedReadTill(double timestamp, double duration)
     {
-        if(data.size() == 0) return false;
         timestamp -= time_sync_offset;
-
-        //if timestamp is greater than the next packet increment the _end packet
-        while(std::next(_end.packet_it) != data.end() && std::next(_end.packet_it)->timestamp() < timestamp)
-            std::advance(_end.packet_it, 1);
-
-        while(timestamp - _begin.packet_it->timestamp() > duration) {
-            if(std::next(_begin.packet_it) == data.end()) {
-                return false; //finish the dataset
-            } else {
-                std::advance(_begin.packet_it, 1); //increment the oldest packet
+        std::unique_lock<std::mutex> lk(m);
+        read_time = timestamp;
+        consumed.notify_one();
+
+        parsed.wait(lk, [this, &timestamp]{return finished ||
+                    (!active.empty() && active.back()->timestamp() >= timestamp);});
+        if(active.empty()) return false;
+
+        //recycle the packets that have left the window (keeping at least one)
+        auto first = active.begin();
+        while(timestamp - (*first)->timestamp() > duration) {
+            if(std::next(first) == active.end()) {
+                if(finished) return false; //finish the dataset
+                break;
             }
-            if(_begin.packet_it == _end.packet_it) break; //return atleast a single packet
+            first++;
         }
+        _release(first);
 
-        setIterators(_begin.packet_it, _end.packet_it);
+        auto last = active.begin();
+        while(std::next(last) != active.end() && (*std::next(last))->timestamp() < timestamp)
+            last++;
+        _resetIterators(active.begin(), last);
 
         return true;
-
     }
 
     iterator begin() { return _begin; }
@@ -957,34 +3245,30 @@ public:
 
     std::string getinfo() {
         std::stringstream ss;
-        if(data.size() == 0)
+        std::lock_guard<std::mutex> lk(m);
+        if(packet_count == 0)
             return "no events loaded";
-        
-        ss << data.size() << " packets loaded with " << event_count << " total events. "
-           << "Timestamps range from " << std::fixed << std::setprecision(3) << data.begin()->timestamp() << " to " << std::prev(data.end())->timestamp();
-        
+
+        ss << "streaming with " << read_ahead << " s read-ahead. "
+           << packet_count << " packets parsed with " << event_count << " total events"
+           << (finished ? ". " : " so far. ")
+           << "Timestamps range from " << std::fixed << std::setprecision(3) << start_time << " to " << latest_time;
+
         return ss.str();
     }
 
-    double getLength() 
+    //length of the data parsed so far
+    double getLength()
     {
-        if(data.size())
-            return std::prev(data.end())->timestamp() - data.begin()->timestamp();
-        else
-            return 0.0;
+        std::lock_guard<std::mutex> lk(m);
+        return latest_time - start_time;
     }
 
     double getStartTime()
     {
-        if(data.size())
-            return data.begin()->timestamp();
-        else
-            return 0.0;
+        return start_time;
     }
 
 };
 
 }
-
-
-
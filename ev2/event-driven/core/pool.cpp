@@ -0,0 +1,117 @@
+/*
+ *   Copyright (C) 2021 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <event-driven/core/pool.h>
+#include <cstdlib>
+#include <new>
+
+namespace ev {
+
+packetPool& packetPool::instance()
+{
+    //never destroyed, so packets released during static destruction are safe
+    static packetPool *pool = new packetPool;
+    return *pool;
+}
+
+unsigned int packetPool::sizeClass(size_t bytes)
+{
+    unsigned int c = min_class;
+    while(c < sizeof(size_t) * 8 - 1 && ((size_t)1 << c) < bytes) c++;
+    return c;
+}
+
+void* packetPool::allocate(size_t bytes)
+{
+    unsigned int c = sizeClass(bytes);
+    size_t class_bytes = c > max_class ? bytes : (size_t)1 << c;
+
+    {
+        std::lock_guard<std::mutex> lk(m);
+        current.requests++;
+        current.in_use += class_bytes;
+        if(current.in_use > current.high_water)
+            current.high_water = current.in_use;
+        if(c <= max_class && !free_buffers[c].empty()) {
+            void *ptr = free_buffers[c].back();
+            free_buffers[c].pop_back();
+            current.cached -= class_bytes;
+            return ptr;
+        }
+        current.misses++;
+    }
+
+    void *ptr = nullptr;
+    if(posix_memalign(&ptr, alignment, class_bytes)) {
+        std::lock_guard<std::mutex> lk(m);
+        current.in_use -= class_bytes;
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void packetPool::deallocate(void *ptr, size_t bytes)
+{
+    if(!ptr) return;
+    unsigned int c = sizeClass(bytes);
+    size_t class_bytes = c > max_class ? bytes : (size_t)1 << c;
+
+    {
+        std::lock_guard<std::mutex> lk(m);
+        current.in_use -= class_bytes;
+        if(c <= max_class && (free_buffers[c].empty() ||
+           (free_buffers[c].size() + 1) * class_bytes <= class_limit)) {
+            free_buffers[c].push_back(ptr);
+            current.cached += class_bytes;
+            return;
+        }
+    }
+    free(ptr);
+}
+
+poolStats packetPool::stats()
+{
+    std::lock_guard<std::mutex> lk(m);
+    return current;
+}
+
+void packetPool::trim()
+{
+    std::lock_guard<std::mutex> lk(m);
+    for(auto &buffers : free_buffers) {
+        for(auto ptr : buffers) free(ptr);
+        buffers.clear();
+    }
+    current.cached = 0;
+}
+
+void packetPool::setCacheLimit(size_t bytes)
+{
+    std::lock_guard<std::mutex> lk(m);
+    class_limit = bytes;
+    for(unsigned int c = min_class; c <= max_class; c++) {
+        size_t class_bytes = (size_t)1 << c;
+        while(free_buffers[c].size() > 1 && free_buffers[c].size() * class_bytes > class_limit) {
+            free(free_buffers[c].back());
+            free_buffers[c].pop_back();
+            current.cached -= class_bytes;
+        }
+    }
+}
+
+}
@@ -0,0 +1,133 @@
+/*
+ *   Copyright (C) 2021 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <type_traits>
+#include <cstddef>
+
+namespace ev {
+
+typedef struct
+{
+    size_t in_use;     //bytes currently handed out
+    size_t high_water; //largest in_use reached
+    size_t cached;     //bytes held for reuse
+    size_t requests;   //number of allocations
+    size_t misses;     //allocations that needed new memory
+} poolStats;
+
+/// \brief a process-wide pool of aligned event buffers in power-of-two size
+/// classes. Released buffers are kept for reuse, so once streaming reaches a
+/// steady state packets are filled without allocating. Each size class keeps
+/// at most its cache limit (and at least one buffer); further released
+/// buffers, and those above the largest size class, are freed directly.
+class packetPool
+{
+private:
+
+    static const unsigned int min_class = 12; //4 kB
+    static const unsigned int max_class = 26; //64 MB
+    static const size_t alignment = 64;
+
+    std::mutex m;
+    std::vector<void *> free_buffers[max_class + 1];
+    size_t class_limit{(size_t)1 << 24}; //16 MB
+    poolStats current{0, 0, 0, 0, 0};
+
+    packetPool() {}
+    static unsigned int sizeClass(size_t bytes);
+
+public:
+
+    packetPool(const packetPool&) = delete;
+    packetPool& operator=(const packetPool&) = delete;
+
+    static packetPool& instance();
+
+    void* allocate(size_t bytes);
+    void deallocate(void *ptr, size_t bytes);
+
+    poolStats stats();
+
+    //free all buffers currently held for reuse
+    void trim();
+
+    //bytes kept for reuse in each size class (default 16 MB). Lowering it
+    //frees the buffers above the new limit
+    void setCacheLimit(size_t bytes);
+};
+
+/// \brief a standard allocator drawing from the ev::packetPool
+template <typename T> class poolAllocator
+{
+public:
+
+    typedef T value_type;
+
+    poolAllocator() = default;
+    template <typename U> poolAllocator(const poolAllocator<U>&) {}
+
+    T* allocate(size_t n)
+    {
+        return static_cast<T *>(packetPool::instance().allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T *ptr, size_t n)
+    {
+        packetPool::instance().deallocate(ptr, n * sizeof(T));
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const poolAllocator<T>&, const poolAllocator<U>&) { return true; }
+template <typename T, typename U>
+bool operator!=(const poolAllocator<T>&, const poolAllocator<U>&) { return false; }
+
+/// \brief an allocator that default-initialises elements, leaving plain event
+/// types uninitialised. Growing a packet buffer then does not zero-fill memory
+/// that is about to be overwritten by received events.
+template <typename T, typename A = std::allocator<T> > class defaultInitAllocator : public A
+{
+    typedef std::allocator_traits<A> traits;
+public:
+    template <typename U> struct rebind
+    {
+        using other = defaultInitAllocator<U, typename traits::template rebind_alloc<U> >;
+    };
+
+    using A::A;
+
+    template <typename U> void construct(U *ptr) noexcept(std::is_nothrow_default_constructible<U>::value)
+    {
+        ::new(static_cast<void *>(ptr)) U;
+    }
+
+    template <typename U, typename... Args> void construct(U *ptr, Args&&... args)
+    {
+        traits::construct(static_cast<A &>(*this), ptr, std::forward<Args>(args)...);
+    }
+};
+
+/// \brief uninitialised event storage drawn from the ev::packetPool
+template <typename T> using pooledBuffer = std::vector<T, defaultInitAllocator<T, poolAllocator<T> > >;
+
+}
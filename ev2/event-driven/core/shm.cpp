@@ -0,0 +1,179 @@
+/*
+ *   Copyright (C) 2021 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <event-driven/core/shm.h>
+#include <yarp/os/LogStream.h>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace ev {
+
+static const char shm_magic[8] = "EV2SHM";
+
+shmRing::~shmRing()
+{
+    close();
+}
+
+bool shmRing::map(int fd, size_t capacity, bool writable)
+{
+    size_t page = sysconf(_SC_PAGESIZE);
+    int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    head = (header *)mmap(nullptr, page, prot, MAP_SHARED, fd, 0);
+    if(head == MAP_FAILED) {
+        head = nullptr;
+        return false;
+    }
+
+    //reserve twice the space and map the data in both halves
+    char *base = (char *)mmap(nullptr, 2 * capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(base == MAP_FAILED ||
+       mmap(base, capacity, prot, MAP_SHARED | MAP_FIXED, fd, page) == MAP_FAILED ||
+       mmap(base + capacity, capacity, prot, MAP_SHARED | MAP_FIXED, fd, page) == MAP_FAILED) {
+        if(base != MAP_FAILED) munmap(base, 2 * capacity);
+        munmap(head, page);
+        head = nullptr;
+        return false;
+    }
+    data = base;
+    this->capacity = capacity;
+    return true;
+}
+
+bool shmRing::create(const std::string &name, size_t capacity)
+{
+    close();
+    size_t page = sysconf(_SC_PAGESIZE);
+    capacity = ((capacity + page - 1) / page) * page;
+
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if(fd < 0) {
+        yError() << "Could not create shared memory" << name;
+        return false;
+    }
+    if(ftruncate(fd, page + capacity) < 0 || !map(fd, capacity, true)) {
+        yError() << "Could not map shared memory" << name;
+        ::close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+    ::close(fd);
+
+    head->capacity = capacity;
+    //unique per creation so readers notice a restarted writer
+    head->generation = (uint64_t)std::chrono::system_clock::now().time_since_epoch().count() ^
+                       ((uint64_t)getpid() << 40);
+    head->reserved.store(0);
+    head->written.store(0);
+    memcpy(head->magic, shm_magic, sizeof(shm_magic));
+    this->name = name;
+    owner = true;
+    return true;
+}
+
+bool shmRing::attach(const std::string &name)
+{
+    close();
+    int fd = shm_open(name.c_str(), O_RDONLY, 0600);
+    if(fd < 0) return false;
+
+    size_t page = sysconf(_SC_PAGESIZE);
+    struct stat st;
+    if(fstat(fd, &st) < 0 || (size_t)st.st_size <= page) {
+        ::close(fd);
+        return false;
+    }
+    bool mapped = map(fd, st.st_size - page, false);
+    ::close(fd);
+    if(!mapped) return false;
+    if(memcmp(head->magic, shm_magic, sizeof(shm_magic)) || head->capacity != capacity) {
+        close();
+        return false;
+    }
+    this->name = name;
+    return true;
+}
+
+void shmRing::close()
+{
+    if(!head) return;
+    munmap(data, 2 * capacity);
+    munmap(head, sysconf(_SC_PAGESIZE));
+    if(owner) shm_unlink(name.c_str());
+    head = nullptr; data = nullptr;
+    capacity = 0; owner = false;
+}
+
+bool shmRing::write(const void *src, size_t n, uint64_t &position)
+{
+    if(n > capacity) return false;
+    position = head->written.load(std::memory_order_relaxed);
+    head->reserved.store(position + n, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(data + position % capacity, src, n);
+    head->written.store(position + n, std::memory_order_release);
+    return true;
+}
+
+bool shmRing::read(uint64_t position, void *dst, size_t n) const
+{
+    if(n > capacity || position + n > head->written.load(std::memory_order_acquire))
+        return false;
+    memcpy(dst, data + position % capacity, n);
+
+    //the copy is valid if the writer had not reached the block again
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return head->reserved.load(std::memory_order_relaxed) <= position + capacity;
+}
+
+std::shared_ptr<const shmRing> shmRing::attached(const std::string &name, uint64_t generation)
+{
+    static std::mutex m;
+    //readers still copying from a replaced mapping hold their own reference
+    static std::map<std::string, std::shared_ptr<shmRing> > rings;
+
+    std::lock_guard<std::mutex> lk(m);
+    std::shared_ptr<shmRing> &ring = rings[name];
+    if(ring && ring->getGeneration() == generation)
+        return ring;
+
+    std::shared_ptr<shmRing> fresh = std::make_shared<shmRing>();
+    if(!fresh->attach(name))
+        return nullptr;
+    ring = fresh;
+    return ring;
+}
+
+std::string shmRing::segmentName(const std::string &port_name)
+{
+    std::string segment = "/ev";
+    for(auto c : port_name)
+        segment.push_back(c == '/' ? '.' : c);
+    if(segment.size() >= sizeof(shmReference::segment))
+        segment.resize(sizeof(shmReference::segment) - 1);
+    return segment;
+}
+
+}
@@ -0,0 +1,101 @@
+/*
+ *   Copyright (C) 2021 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+
+namespace ev {
+
+/// \brief the location of a packet's events in an ev::shmRing, sent in place
+/// of the events by ports publishing through shared memory
+typedef struct
+{
+    char segment[64];
+    uint64_t generation;
+    uint64_t position;
+    uint64_t count;
+} shmReference;
+
+/// \brief a byte ring in POSIX shared memory, mapped twice so any block is
+/// contiguous. One process writes and any process on the host can read. The
+/// writer never waits: a reader that falls a full ring behind detects that
+/// its block was overwritten. Blocks are copied in and out (read() validates
+/// the copy, no view into the ring is lent), and readers are woken by the
+/// message carrying the ev::shmReference, not through the segment.
+class shmRing
+{
+private:
+
+    typedef struct
+    {
+        char magic[8];
+        uint64_t capacity;
+        uint64_t generation;            //changes each time the segment is created
+        std::atomic<uint64_t> reserved; //end of the block being written
+        std::atomic<uint64_t> written;  //end of the last complete block
+    } header;
+
+    std::string name;
+    header *head{nullptr};
+    char *data{nullptr};
+    size_t capacity{0};
+    bool owner{false};
+
+    bool map(int fd, size_t capacity, bool writable);
+
+public:
+
+    shmRing() {}
+    ~shmRing();
+    shmRing(const shmRing&) = delete;
+    shmRing& operator=(const shmRing&) = delete;
+
+    //writer: create (or replace) the named segment
+    bool create(const std::string &name, size_t capacity);
+    //reader: map an existing segment read-only
+    bool attach(const std::string &name);
+    void close();
+
+    //copy n bytes into the ring and give their position (false if n is
+    //larger than the ring)
+    bool write(const void *src, size_t n, uint64_t &position);
+    //copy n bytes from position, false if they have been overwritten
+    bool read(uint64_t position, void *dst, size_t n) const;
+
+    //end of the data written so far
+    uint64_t getWritten() const { return head->written.load(std::memory_order_acquire); }
+    uint64_t getGeneration() const { return head->generation; }
+    bool isOpen() const { return head != nullptr; }
+    size_t getCapacity() const { return capacity; }
+    const std::string& getName() const { return name; }
+
+    //a process-wide reader mapping of the named segment (nullptr on failure),
+    //mapped again if it is not of the given generation (the writer has
+    //restarted). A replaced mapping is freed once no caller holds it
+    static std::shared_ptr<const shmRing> attached(const std::string &name, uint64_t generation);
+
+    //a valid segment name derived from a port name
+    static std::string segmentName(const std::string &port_name);
+};
+
+}
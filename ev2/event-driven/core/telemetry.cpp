@@ -0,0 +1,295 @@
+/*
+ *   Copyright (C) 2021 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <event-driven/core/telemetry.h>
+#include <yarp/os/Port.h>
+#include <yarp/os/PortReader.h>
+#include <yarp/os/ConnectionReader.h>
+#include <yarp/os/Bottle.h>
+#include <yarp/os/LogStream.h>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+
+namespace ev {
+
+//all ports registered in the process
+static std::mutex& registry_mutex()
+{
+    static std::mutex m;
+    return m;
+}
+
+static std::vector<portTelemetry *>& registry()
+{
+    static std::vector<portTelemetry *> ports;
+    return ports;
+}
+
+//consumer slots in use
+static bool consumer_slots[portTelemetry::consumers] = {false};
+
+portTelemetry::portTelemetry()
+{
+    for(auto &h : histogram) h = 0;
+    for(auto &mx : latency_max) mx = 0;
+    for(auto &mx : queue_max) mx = 0;
+    for(int c = 0; c <= consumers; c++) {
+        previous[c] = totals();
+        tic[c] = 0.0;
+    }
+}
+
+portTelemetry::~portTelemetry()
+{
+    close();
+}
+
+void portTelemetry::open(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    this->name = name;
+    for(int c = 0; c <= consumers; c++)
+        reset(c);
+    if(!registered) registry().push_back(this);
+    registered = true;
+}
+
+void portTelemetry::close()
+{
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    if(!registered) return;
+    auto &ports = registry();
+    ports.erase(std::remove(ports.begin(), ports.end(), this), ports.end());
+    registered = false;
+}
+
+double portTelemetry::_percentile(const uint64_t *counts, uint64_t n, double q) const
+{
+    if(!n) return 0.0;
+    uint64_t target = (uint64_t)(q * n + 0.5);
+    uint64_t cumulative = 0;
+    for(int b = 0; b < bins; b++) {
+        cumulative += counts[b];
+        if(cumulative >= target && cumulative)
+            return b ? (double)(1ull << b) * 1e-6 : 1e-6;
+    }
+    return (double)(1ull << (bins - 1)) * 1e-6;
+}
+
+portTelemetry::totals portTelemetry::_totals() const
+{
+    totals t;
+    t.events = events.load(std::memory_order_relaxed);
+    t.packets = packets.load(std::memory_order_relaxed);
+    t.latency_us = latency_us.load(std::memory_order_relaxed);
+    t.latency_n = latency_n.load(std::memory_order_relaxed);
+    for(int b = 0; b < bins; b++)
+        t.histogram[b] = histogram[b].load(std::memory_order_relaxed);
+    t.queue_sum = queue_sum.load(std::memory_order_relaxed);
+    t.reads = reads.load(std::memory_order_relaxed);
+    t.consumer_us = consumer_us.load(std::memory_order_relaxed);
+    return t;
+}
+
+void portTelemetry::reset(int consumer)
+{
+    if(consumer < 0 || consumer > consumers) return;
+    std::lock_guard<std::mutex> lock(m);
+    previous[consumer] = _totals();
+    tic[consumer] = yarp::os::Time::now();
+    latency_max[consumer] = 0;
+    queue_max[consumer] = 0;
+}
+
+void portTelemetry::join(int consumer)
+{
+    if(consumer < 0 || consumer >= consumers) return;
+    std::lock_guard<std::mutex> lock(m);
+    previous[consumer] = previous[consumers];
+    tic[consumer] = tic[consumers];
+    latency_max[consumer] = latency_max[consumers].load();
+    queue_max[consumer] = queue_max[consumers].load();
+}
+
+portStats portTelemetry::snapshot(int consumer)
+{
+    //the last slot holds the state at open and is never moved on
+    int c = consumer >= 0 && consumer < consumers ? consumer : consumers;
+
+    std::lock_guard<std::mutex> lock(m);
+    double toc = yarp::os::Time::now();
+    double period = toc - tic[c];
+    totals now = _totals();
+    const totals &before = previous[c];
+
+    uint64_t counts[bins];
+    for(int b = 0; b < bins; b++)
+        counts[b] = now.histogram[b] - before.histogram[b];
+    uint64_t n = now.latency_n - before.latency_n;
+    uint64_t n_reads = now.reads - before.reads;
+    uint64_t latency_sum = now.latency_us - before.latency_us;
+    uint64_t queue_total = now.queue_sum - before.queue_sum;
+
+    portStats s;
+    s.name = name;
+    s.period = period;
+    if(period <= 0.0) period = 1.0;
+    s.events_rate = (now.events - before.events) / period;
+    s.packets_rate = (now.packets - before.packets) / period;
+    s.latency_mean = n ? latency_sum * 1e-6 / n : 0.0;
+    s.latency_p50 = _percentile(counts, n, 0.50);
+    s.latency_p99 = _percentile(counts, n, 0.99);
+    s.consumer_load = (now.consumer_us - before.consumer_us) * 1e-6 / period;
+    s.queue_mean = n_reads ? (double)queue_total / n_reads : 0.0;
+    if(c < consumers) {
+        s.latency_max = latency_max[c].exchange(0, std::memory_order_relaxed) * 1e-6;
+        s.queue_max = queue_max[c].exchange(0, std::memory_order_relaxed);
+        previous[c] = now;
+        tic[c] = toc;
+    } else {
+        s.latency_max = latency_max[c].load(std::memory_order_relaxed) * 1e-6;
+        s.queue_max = queue_max[c].load(std::memory_order_relaxed);
+    }
+    s.latency_p50 = std::min(s.latency_p50, s.latency_max);
+    s.latency_p99 = std::min(s.latency_p99, s.latency_max);
+    return s;
+}
+
+telemetryConsumer::telemetryConsumer()
+{
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    for(int c = 0; c < portTelemetry::consumers && slot < 0; c++)
+        if(!consumer_slots[c]) slot = c;
+    if(slot < 0) {
+        yWarning() << "Too many telemetry consumers: reporting statistics since each port opened";
+        return;
+    }
+    consumer_slots[slot] = true;
+    for(auto p : registry())
+        p->join(slot);
+}
+
+telemetryConsumer::~telemetryConsumer()
+{
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    if(slot >= 0) consumer_slots[slot] = false;
+}
+
+std::vector<portStats> telemetryConsumer::snapshot()
+{
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    std::vector<portStats> all;
+    for(auto p : registry())
+        all.push_back(p->snapshot(slot));
+    return all;
+}
+
+std::vector<portStats> telemetrySnapshot()
+{
+    static telemetryConsumer consumer;
+    return consumer.snapshot();
+}
+
+//replies to any command with the statistics of every port
+class telemetryReader : public yarp::os::PortReader
+{
+public:
+
+    bool read(yarp::os::ConnectionReader &connection) override
+    {
+        yarp::os::Bottle command, reply;
+        if(!command.read(connection)) return false;
+
+        for(auto &s : consumer.snapshot()) {
+            yarp::os::Bottle &b = reply.addList();
+            b.addString(s.name);
+            b.addFloat64(s.events_rate);
+            b.addFloat64(s.packets_rate);
+            b.addFloat64(s.latency_mean);
+            b.addFloat64(s.latency_p50);
+            b.addFloat64(s.latency_p99);
+            b.addFloat64(s.latency_max);
+            b.addFloat64(s.queue_mean);
+            b.addInt32(s.queue_max);
+            b.addFloat64(s.consumer_load);
+        }
+
+        yarp::os::ConnectionWriter *writer = connection.getWriter();
+        if(writer) reply.write(*writer);
+        return true;
+    }
+
+private:
+
+    telemetryConsumer consumer;
+};
+
+static std::unique_ptr<yarp::os::Port> telemetry_port;
+static std::unique_ptr<telemetryReader> telemetry_reader;
+
+bool openTelemetryPort(const std::string &name)
+{
+    telemetry_reader.reset(new telemetryReader);
+    telemetry_port.reset(new yarp::os::Port);
+    telemetry_port->setReader(*telemetry_reader);
+    if(!telemetry_port->open(name)) {
+        yError() << "Could not open port: " << name;
+        telemetry_port.reset();
+        telemetry_reader.reset();
+        return false;
+    }
+    return true;
+}
+
+void closeTelemetryPort()
+{
+    if(telemetry_port) telemetry_port->close();
+    telemetry_port.reset();
+    telemetry_reader.reset();
+}
+
+bool writeTelemetry(const std::string &file_name)
+{
+    bool exists = std::ifstream(file_name).good();
+    std::ofstream writer(file_name, std::ios_base::app);
+    if(!writer.is_open()) {
+        yError() << "Could not open telemetry file:" << file_name;
+        return false;
+    }
+
+    if(!exists)
+        writer << "time,port,period,events_rate,packets_rate,latency_mean,"
+                  "latency_p50,latency_p99,latency_max,queue_mean,queue_max,"
+                  "consumer_load" << std::endl;
+
+    static telemetryConsumer consumer;
+    double now = yarp::os::Time::now();
+    writer << std::fixed << std::setprecision(6);
+    for(auto &s : consumer.snapshot())
+        writer << now << "," << s.name << "," << s.period << ","
+               << s.events_rate << "," << s.packets_rate << ","
+               << s.latency_mean << "," << s.latency_p50 << ","
+               << s.latency_p99 << "," << s.latency_max << ","
+               << s.queue_mean << "," << s.queue_max << ","
+               << s.consumer_load << std::endl;
+    return true;
+}
+
+}
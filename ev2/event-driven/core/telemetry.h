@@ -0,0 +1,195 @@
+/*
+ *   Copyright (C) 2021 Event-driven Perception for Robotics
+ *   Author: arren.glover@iit.it
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU Lesser General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public License
+ *   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <yarp/os/Time.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace ev {
+
+/// statistics of a single port since the consumer's previous snapshot
+typedef struct
+{
+    std::string name;
+    double period;          //seconds covered by these statistics
+    double events_rate;     //events per second
+    double packets_rate;    //packets per second
+    double latency_mean;    //envelope to receive (seconds)
+    double latency_p50;     //upper edge of the histogram bin
+    double latency_p99;
+    double latency_max;
+    double queue_mean;      //unprocessed events when a read returns
+    unsigned int queue_max; //(queued packets for ev::BufferedPort)
+    double consumer_load;   //fraction of the period spent between reads
+} portStats;
+
+/// \brief counters kept by every ev:: port. The port thread records packets
+/// as they arrive and the reading thread records each read, neither takes a
+/// lock. The counters only increase: each ev::telemetryConsumer keeps its own
+/// previous totals, so several consumers can take snapshots independently.
+class portTelemetry
+{
+public:
+
+    //consumers that can take snapshots at the same time
+    static const int consumers = 4;
+
+private:
+
+    //latency histogram bin b holds [2^(b-1), 2^b) microseconds
+    static const int bins = 32;
+
+    typedef struct
+    {
+        uint64_t events;
+        uint64_t packets;
+        uint64_t latency_us;
+        uint64_t latency_n;
+        uint64_t histogram[bins];
+        uint64_t queue_sum;
+        uint64_t reads;
+        uint64_t consumer_us;
+    } totals;
+
+    std::string name;
+    bool registered{false};
+
+    std::atomic<uint64_t> events{0};
+    std::atomic<uint64_t> packets{0};
+    std::atomic<uint64_t> latency_us{0};
+    std::atomic<uint64_t> latency_n{0};
+    std::atomic<uint64_t> histogram[bins];
+    std::atomic<uint64_t> queue_sum{0};
+    std::atomic<uint64_t> reads{0};
+    std::atomic<uint64_t> consumer_us{0};
+
+    //maxima since each consumer's previous snapshot (the last since open)
+    std::atomic<uint64_t> latency_max[consumers + 1];
+    std::atomic<uint64_t> queue_max[consumers + 1];
+
+    //reading thread only
+    double last_read{0.0};
+
+    //the totals at each consumer's previous snapshot (the last at open)
+    std::mutex m;
+    totals previous[consumers + 1];
+    double tic[consumers + 1];
+
+    static void _max(std::atomic<uint64_t> &a, uint64_t v)
+    {
+        uint64_t current = a.load(std::memory_order_relaxed);
+        while(v > current && !a.compare_exchange_weak(current, v, std::memory_order_relaxed));
+    }
+
+    double _percentile(const uint64_t *counts, uint64_t n, double q) const;
+    totals _totals() const;
+
+public:
+
+    portTelemetry();
+    ~portTelemetry();
+
+    //list the port with the process telemetry under the port name
+    void open(const std::string &name);
+    void close();
+    const std::string& getName() const { return name; }
+
+    //a packet of events has arrived (or been sent). Latency is measured
+    //from the envelope time, if the sender set one
+    void record(size_t count, double envelope_time = 0.0)
+    {
+        events.fetch_add(count, std::memory_order_relaxed);
+        packets.fetch_add(1, std::memory_order_relaxed);
+        if(envelope_time <= 0.0) return;
+
+        double latency = yarp::os::Time::now() - envelope_time;
+        uint64_t us = latency > 0.0 ? (uint64_t)(latency * 1e6) : 0;
+        latency_us.fetch_add(us, std::memory_order_relaxed);
+        latency_n.fetch_add(1, std::memory_order_relaxed);
+        for(auto &mx : latency_max) _max(mx, us);
+        int b = 0;
+        while(us && b < bins - 1) { us >>= 1; b++; }
+        histogram[b].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    //the consumer asks for data: the time since the last read returned was
+    //spent processing it
+    void readStart()
+    {
+        if(last_read > 0.0)
+            consumer_us.fetch_add((uint64_t)((yarp::os::Time::now() - last_read) * 1e6),
+                                  std::memory_order_relaxed);
+    }
+
+    //the read returns with queued data left unprocessed
+    void readEnd(size_t queued)
+    {
+        last_read = yarp::os::Time::now();
+        queue_sum.fetch_add(queued, std::memory_order_relaxed);
+        for(auto &mx : queue_max) _max(mx, queued);
+        reads.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    //start a consumer's statistics from now, or from when the port opened
+    void reset(int consumer);
+    void join(int consumer);
+    //statistics since the consumer's previous snapshot (or since open if
+    //consumer is negative)
+    portStats snapshot(int consumer);
+};
+
+/// \brief a reader of the statistics of every open ev:: port in the process
+/// (e.g. a csv log or an rpc port). Each snapshot covers the time since its
+/// own previous one. Up to portTelemetry::consumers can exist at once, any
+/// more report the statistics since each port was opened.
+class telemetryConsumer
+{
+private:
+
+    int slot{-1};
+
+public:
+
+    telemetryConsumer();
+    ~telemetryConsumer();
+    telemetryConsumer(const telemetryConsumer&) = delete;
+    telemetryConsumer& operator=(const telemetryConsumer&) = delete;
+
+    std::vector<portStats> snapshot();
+};
+
+//the statistics of every open ev:: port since the previous call
+std::vector<portStats> telemetrySnapshot();
+
+//open an rpc port that replies to any command with a list of
+//(name events/s packets/s latency_mean latency_p50 latency_p99 latency_max
+// queue_mean queue_max consumer_load) for each port
+bool openTelemetryPort(const std::string &name);
+void closeTelemetryPort();
+
+//append a snapshot of every port to a csv file (a header is written if the
+//file is new)
+bool writeTelemetry(const std::string &file_name);
+
+}
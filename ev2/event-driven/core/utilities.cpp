@@ -22,6 +22,13 @@
 //#include <sstream>
 #include <unistd.h>
 #include <limits>
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define EV_UNWRAP_AVX2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define EV_UNWRAP_NEON 1
+#endif
 
 namespace ev {
 
@@ -34,6 +41,151 @@ bool ts_status = true;
 bool ts_status = false;
 #endif
 
+//the timestamp bits of the first word of an event
+static const uint32_t ts_mask = 0x7FFFFFFF;
+
+#if EV_UNWRAP_AVX2
+//the library is not built with -mavx2, so the AVX2 code is compiled for the
+//target separately and selected at runtime
+static bool hasAVX2()
+{
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+
+//unwrap blocks of 8 timestamps, returning the number of events done. Wraps
+//are found by comparing each timestamp with its predecessor and the running
+//count of wraps is an inclusive prefix sum across the lanes
+__attribute__((target("avx2")))
+static size_t unwrapAVX2(const uint32_t *words, size_t n, unsigned int stride, uint64_t *out, int &last, unsigned int &wraps, unsigned int wrap_stamp)
+{
+    const __m256i mask = _mm256_set1_epi32(ts_mask);
+    const __m256i index = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+    const __m256i previous = _mm256_setr_epi32(7, 0, 1, 2, 3, 4, 5, 6);
+    const __m256i shift1 = _mm256_setr_epi32(0, 0, 1, 2, 3, 4, 5, 6);
+    const __m256i shift2 = _mm256_setr_epi32(0, 0, 0, 1, 2, 3, 4, 5);
+    const __m256i shift4 = _mm256_setr_epi32(0, 0, 0, 0, 0, 1, 2, 3);
+    const __m256i keep1 = _mm256_setr_epi32(0, -1, -1, -1, -1, -1, -1, -1);
+    const __m256i keep2 = _mm256_setr_epi32(0, 0, -1, -1, -1, -1, -1, -1);
+    const __m256i keep4 = _mm256_setr_epi32(0, 0, 0, 0, -1, -1, -1, -1);
+    const __m256i period = _mm256_set1_epi64x(wrap_stamp);
+
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        const uint32_t *block = words + i * stride;
+        __m256i ts = stride == 1 ? _mm256_loadu_si256((const __m256i *)block)
+                                 : _mm256_i32gather_epi32((const int *)block, index, 4);
+        ts = _mm256_and_si256(ts, mask);
+
+        //1 where a timestamp is lower than the one before it
+        __m256i prev = _mm256_permutevar8x32_epi32(ts, previous);
+        prev = _mm256_blend_epi32(prev, _mm256_set1_epi32(last), 0x01);
+        __m256i w = _mm256_srli_epi32(_mm256_cmpgt_epi32(prev, ts), 31);
+
+        //prefix sum of the wraps
+        w = _mm256_add_epi32(w, _mm256_and_si256(_mm256_permutevar8x32_epi32(w, shift1), keep1));
+        w = _mm256_add_epi32(w, _mm256_and_si256(_mm256_permutevar8x32_epi32(w, shift2), keep2));
+        w = _mm256_add_epi32(w, _mm256_and_si256(_mm256_permutevar8x32_epi32(w, shift4), keep4));
+        __m256i total = _mm256_add_epi32(w, _mm256_set1_epi32(wraps));
+
+        //ts + max_stamp * wraps in 64 bits
+        __m256i lo = _mm256_add_epi64(_mm256_cvtepu32_epi64(_mm256_castsi256_si128(ts)),
+            _mm256_mul_epu32(_mm256_cvtepu32_epi64(_mm256_castsi256_si128(total)), period));
+        __m256i hi = _mm256_add_epi64(_mm256_cvtepu32_epi64(_mm256_extracti128_si256(ts, 1)),
+            _mm256_mul_epu32(_mm256_cvtepu32_epi64(_mm256_extracti128_si256(total, 1)), period));
+        _mm256_storeu_si256((__m256i *)(out + i), lo);
+        _mm256_storeu_si256((__m256i *)(out + i + 4), hi);
+
+        wraps = _mm256_extract_epi32(total, 7);
+        last = _mm256_extract_epi32(ts, 7);
+    }
+    return i;
+}
+#endif
+
+#if EV_UNWRAP_NEON
+//unwrap blocks of 4 timestamps as for AVX2
+static size_t unwrapNEON(const uint32_t *words, size_t n, unsigned int stride, uint64_t *out, int &last, unsigned int &wraps, unsigned int wrap_stamp)
+{
+    const uint32x4_t mask = vdupq_n_u32(ts_mask);
+    const uint32x4_t zero = vdupq_n_u32(0);
+    const uint32x2_t period = vdup_n_u32(wrap_stamp);
+
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4) {
+        const uint32_t *block = words + i * stride;
+        uint32x4_t ts;
+        if(stride == 1) {
+            ts = vld1q_u32(block);
+        } else if(stride == 2) {
+            ts = vld2q_u32(block).val[0];
+        } else {
+            uint32_t gathered[4] = {block[0], block[stride], block[2 * stride], block[3 * stride]};
+            ts = vld1q_u32(gathered);
+        }
+        ts = vandq_u32(ts, mask);
+
+        uint32x4_t prev = vextq_u32(vdupq_n_u32(last), ts, 3);
+        uint32x4_t w = vshrq_n_u32(vcgtq_u32(prev, ts), 31);
+        w = vaddq_u32(w, vextq_u32(zero, w, 3));
+        w = vaddq_u32(w, vextq_u32(zero, w, 2));
+        uint32x4_t total = vaddq_u32(w, vdupq_n_u32(wraps));
+
+        vst1q_u64(out + i, vmlal_u32(vmovl_u32(vget_low_u32(ts)), vget_low_u32(total), period));
+        vst1q_u64(out + i + 2, vmlal_u32(vmovl_u32(vget_high_u32(ts)), vget_high_u32(total), period));
+
+        wraps = vgetq_lane_u32(total, 3);
+        last = vgetq_lane_u32(ts, 3);
+    }
+    return i;
+}
+#endif
+
+void vtsHelper::unwrap(const uint32_t *words, size_t n, unsigned int stride, uint64_t *out)
+{
+    size_t i = 0;
+    const unsigned int wrap_stamp = wrap();
+#if EV_UNWRAP_AVX2
+    if(hasAVX2())
+        i = unwrapAVX2(words, n, stride, out, last_stamp, n_wraps, wrap_stamp);
+#elif EV_UNWRAP_NEON
+    i = unwrapNEON(words, n, stride, out, last_stamp, n_wraps, wrap_stamp);
+#endif
+
+    //remaining events (or all without SIMD), without branching
+    for(; i < n; i++) {
+        int timestamp = words[i * stride] & ts_mask;
+        n_wraps += last_stamp > timestamp;
+        last_stamp = timestamp;
+        out[i] = timestamp + (uint64_t)wrap_stamp * n_wraps;
+    }
+}
+
+void setClock(unsigned int period_ns, unsigned int timer_bits)
+{
+    if(!period_ns || !timer_bits || timer_bits > 31) {
+        yError() << "Invalid event clock:" << period_ns << "ns," << timer_bits << "bits";
+        return;
+    }
+    max_stamp = (1u << timer_bits) - 1;
+    tsscaler = 0.000000001 * period_ns;
+    vtsscaler = 1000000000.0 / period_ns;
+}
+
+bool setClock(const yarp::os::Searchable &options)
+{
+    int period_ns = options.check("clock_period", yarp::os::Value((int)round(tsscaler * 1e9))).asInt32();
+    int timer_bits = options.check("timer_bits", yarp::os::Value((int)round(log2((double)max_stamp + 1)))).asInt32();
+    if(period_ns <= 0 || timer_bits <= 0 || timer_bits > 31) {
+        yError() << "Invalid event clock:" << period_ns << "ns," << timer_bits << "bits";
+        return false;
+    }
+    setClock(period_ns, timer_bits);
+    if(options.check("clock_period") || options.check("timer_bits"))
+        yInfo() << "Event clock:" << period_ns << "ns," << timer_bits << "bits";
+    return true;
+}
+
 benchmark::benchmark()
 {
     initialised = true;
@@ -20,10 +20,12 @@
 #define __VTSHELPER__
 
 #include <yarp/os/Bottle.h>
+#include <yarp/os/Searchable.h>
 #include <yarp/os/LogStream.h>
 #include <fstream>
 #include <math.h>
 #include <vector>
+#include <cstdint>
 #include "codec.h"
 
 namespace ev {
@@ -38,7 +40,8 @@ enum { CAMERA_LEFT = 0, CAMERA_RIGHT = 1 } ;
 #define IS_IMU(x)       x&0x02000000
 #define IS_AUDIO(x)     x&0x04000000
 
-/// the maximum value of the timestamp before a wrap occurs
+/// the maximum value of the timestamp before a wrap occurs (by default
+/// from the TIMER_BITS build option, see ev::setClock)
 extern unsigned int max_stamp;
 /// a multiplier to convert an event timestamp to seconds
 extern double tsscaler;
@@ -47,6 +50,114 @@ extern double vtsscaler;
 /// a flag to read if individual event timestamps are enabled
 extern bool ts_status;
 
+/// \brief set the timestamp clock used by this process at runtime (instead
+/// of the CLOCK_PERIOD and TIMER_BITS build options), e.g. for a 1 us
+/// Prophesee USB camera. Call before opening ports or windows. Windows
+/// reading sensors with other clocks take an ev::sensorClock instead.
+void setClock(unsigned int period_ns, unsigned int timer_bits);
+
+/// \brief set the clock from --clock_period <ns> and --timer_bits options,
+/// keeping the current values for any not given. False if invalid.
+bool setClock(const yarp::os::Searchable &options);
+
+/// \brief a compile-time sensor clock, for per-sensor hot loops that want
+/// constexpr scaling independent of the process clock
+template <unsigned int period_ns, unsigned int timer_bits> struct clockPolicy
+{
+    static_assert(timer_bits > 0 && timer_bits <= 31, "Maximum bits useable is 31");
+
+    static constexpr unsigned int period() { return period_ns; }
+    static constexpr unsigned int bits() { return timer_bits; }
+    static constexpr unsigned int maxStamp() { return (1u << timer_bits) - 1; }
+    static constexpr double tsscaler() { return 0.000000001 * period_ns; }
+    static constexpr double vtsscaler() { return 1000000000.0 / period_ns; }
+
+    static constexpr double ticksToSeconds(const unsigned int tick)
+    {
+        return tick * tsscaler();
+    }
+
+    static constexpr unsigned int secondsToTicks(const double seconds)
+    {
+        return seconds * vtsscaler();
+    }
+
+    static constexpr int deltaTicks(const int current_tick, const int prev_tick)
+    {
+        return current_tick < prev_tick ? current_tick - prev_tick + (int)maxStamp()
+                                        : current_tick - prev_tick;
+    }
+
+    //make this the process clock
+    static void use() { setClock(period_ns, timer_bits); }
+};
+
+/// the clock of the zynq (ATIS gen3) cameras
+using atis3Clock = clockPolicy<80, 30>;
+/// the clock of Prophesee USB cameras (microseconds)
+using usbClock = clockPolicy<1000, 31>;
+/// the clock selected at build time
+using buildClock = clockPolicy<CLOCK_PERIOD, TIMER_BITS>;
+
+/// \brief a sensor clock chosen at runtime, for windows and inputs reading a
+/// sensor whose clock differs from the process clock (e.g. an 80 ns camera
+/// and a 1 us camera in one process). Default constructed it follows the
+/// process clock.
+class sensorClock
+{
+private:
+
+    unsigned int max_ticks{0}; //0 to follow the process clock
+    double scaler{0.0};
+    double vscaler{0.0};
+
+public:
+
+    sensorClock() {}
+
+    sensorClock(unsigned int period_ns, unsigned int timer_bits)
+    {
+        if(!period_ns || !timer_bits || timer_bits > 31) {
+            yError() << "Invalid event clock:" << period_ns << "ns," << timer_bits << "bits";
+            return;
+        }
+        max_ticks = (1u << timer_bits) - 1;
+        scaler = 0.000000001 * period_ns;
+        vscaler = 1000000000.0 / period_ns;
+    }
+
+    /// \brief e.g. ev::sensorClock clock{ev::usbClock()}
+    template <unsigned int period_ns, unsigned int timer_bits>
+    sensorClock(clockPolicy<period_ns, timer_bits>): sensorClock(period_ns, timer_bits) {}
+
+    bool followsProcess() const { return !max_ticks; }
+    unsigned int maxStamp() const { return max_ticks ? max_ticks : max_stamp; }
+    double tsscaler() const { return max_ticks ? scaler : ev::tsscaler; }
+    double vtsscaler() const { return max_ticks ? vscaler : ev::vtsscaler; }
+
+    double ticksToSeconds(const uint64_t tick) const
+    {
+        return tick * tsscaler();
+    }
+
+    unsigned int secondsToTicks(const double seconds) const
+    {
+        return seconds * vtsscaler();
+    }
+
+    int deltaTicks(const int current_tick, const int prev_tick) const
+    {
+        int dt = current_tick - prev_tick;
+        if(dt < 0) dt += maxStamp();
+        return dt;
+    }
+
+    uint64_t deltaTicks(const uint64_t current_tick, const uint64_t prev_tick) const
+    {
+        return current_tick - prev_tick;
+    }
+};
+
 static inline double ticksToSeconds(const unsigned int tick)
 {
     (void)ticksToSeconds;
@@ -66,6 +177,13 @@ static int deltaTicks(const int current_tick, const int prev_tick)
     return dt;
 }
 
+/// \brief ticks between unwrapped 64 bit timestamps (e.g. ev::longAE)
+static inline uint64_t deltaTicks(const uint64_t current_tick, const uint64_t prev_tick)
+{
+    (void)(uint64_t (*)(const uint64_t, const uint64_t))deltaTicks;
+    return current_tick - prev_tick;
+}
+
 static double deltaS(const int current_tick, const int prev_tick)
 {
     return deltaTicks(current_tick, prev_tick) * tsscaler;
@@ -84,11 +202,24 @@ private:
 
     int last_stamp;
     unsigned int n_wraps;
+    unsigned int wrap_stamp; //0 to follow the process clock
+
+    unsigned int wrap() const { return wrap_stamp ? wrap_stamp : max_stamp; }
 
 public:
 
-    /// \brief constructor
-    vtsHelper(): last_stamp(0), n_wraps(0) {}
+    /// \brief constructor (unwrapping with the process clock)
+    vtsHelper(): last_stamp(0), n_wraps(0), wrap_stamp(0) {}
+
+    /// \brief constructor for a sensor with its own clock, e.g.
+    /// ev::vtsHelper helper{ev::usbClock()}
+    template <unsigned int period_ns, unsigned int timer_bits>
+    vtsHelper(clockPolicy<period_ns, timer_bits>):
+        last_stamp(0), n_wraps(0), wrap_stamp(clockPolicy<period_ns, timer_bits>::maxStamp()) {}
+
+    /// \brief constructor for a sensor with a clock chosen at runtime
+    vtsHelper(const sensorClock &clock):
+        last_stamp(0), n_wraps(0), wrap_stamp(clock.followsProcess() ? 0 : clock.maxStamp()) {}
 
     /// \brief unwrap a timestamp, given previously unwrapped timestamps
     unsigned long int operator() (int timestamp) {
@@ -99,7 +230,26 @@ public:
     }
 
     /// \brief ask for the current unwrapped time, without updating the time.
-    unsigned long int currentTime() { return last_stamp + ((unsigned long int)max_stamp*n_wraps); }
+    unsigned long int currentTime() { return last_stamp + ((unsigned long int)wrap()*n_wraps); }
+
+    /// \brief unwrap the timestamps of n events into out, giving the same
+    /// result as calling operator() on each. The timestamp is read from the
+    /// first of every stride 32-bit words. Vectorised with AVX2 or NEON when
+    /// the processor has it.
+    void unwrap(const uint32_t *words, size_t n, unsigned int stride, uint64_t *out);
+
+    /// \brief unwrap the timestamps of n contiguous events (e.g. a packet)
+    template <typename T> void unwrap(const T *events, size_t n, uint64_t *out)
+    {
+        static_assert(sizeof(T) % sizeof(uint32_t) == 0, "events must be made of 32 bit words");
+        unwrap((const uint32_t *)events, n, sizeof(T) / sizeof(uint32_t), out);
+    }
+
+    /// \brief unwrap n plain 32 bit timestamps (e.g. ev::eventArrays::ts)
+    void unwrap(const uint32_t *timestamps, size_t n, uint64_t *out)
+    {
+        unwrap(timestamps, n, 1, out);
+    }
 
 };
 
@@ -42,17 +42,15 @@ void spatialFilter::initialise(int height, int width, double period = 0.1, int r
 {
     this->range = range;
     this->period = period;
-    for(auto& sae : saes)
-        sae = cv::Mat::zeros(height +2*range, width+2*range, CV_64F);
+    saes.init(width, height, 2*range+1);
 }
 
 bool spatialFilter::check(const AE& v, const double ts)
 {
-    static int fr = 2*range+1; 
     bool pass = true;
-    if(ts - period > saes[v.p].at<double>(v.y+range, v.x+range))
+    if(ts - period > saes.at(v.x, v.y, v.p))
         pass = false;
-    saes[v.p]({(int)v.x, (int)v.y, fr, fr}) = ts;
+    saes.update(v.x, v.y, ts, v.p);
     return pass;
 }
 
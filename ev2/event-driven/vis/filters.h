@@ -20,6 +20,7 @@
 
 #include <opencv2/opencv.hpp>
 #include "event-driven/core.h"
+#include "event-driven/algs/surface.h"
 
 namespace ev {
 
@@ -66,7 +67,7 @@ public:
 class spatialFilter
 {
 private:
-    std::array<cv::Mat, 2> saes;
+    channelSurface<2> saes;
     double period;
     double range;
 